@@ -23,6 +23,8 @@ ttest(byte_stream_one_write)
 ttest(byte_stream_two_writes)
 ttest(byte_stream_many_writes)
 ttest(byte_stream_stress_test)
+ttest(byte_stream_spans)
+ttest(byte_stream_readv)
 
 ttest(reassembler_single)
 ttest(reassembler_cap)
@@ -31,6 +33,9 @@ ttest(reassembler_dup)
 ttest(reassembler_holes)
 ttest(reassembler_overlapping)
 ttest(reassembler_win)
+ttest(reassembler_engines)
+ttest(reassembler_limits)
+ttest(reassembler_batch)
 
 ttest(wrapping_integers_cmp)
 ttest(wrapping_integers_wrap)
@@ -45,6 +50,12 @@ ttest(recv_reorder)
 ttest(recv_reorder_more)
 ttest(recv_close)
 ttest(recv_special)
+ttest(recv_sack)
+ttest(recv_batch)
+ttest(recv_delayed_ack)
+ttest(recv_autotune)
+ttest(recv_timestamps)
+ttest(recv_prediction)
 
 ttest(send_connect)
 ttest(send_transmit)
@@ -53,6 +64,10 @@ ttest(send_window)
 ttest(send_ack)
 ttest(send_close)
 ttest(send_extra)
+ttest(send_timestamps)
+ttest(send_congestion)
+ttest(send_rto)
+ttest(send_bbr)
 
 ttest(net_interface)
 
@@ -85,4 +100,12 @@ set_property(TEST ${compile_name_opt} PROPERTY TIMEOUT -1)
 set_tests_properties(${compile_name_opt} PROPERTIES FIXTURES_SETUP compile_opt)
 
 stest(byte_stream_speed_test)
+stest(byte_stream_spsc_speed_test)
+# Two busy threads: run alone, so a small machine has a CPU for each
+set_property(TEST byte_stream_spsc_speed_test PROPERTY RUN_SERIAL TRUE)
+stest(byte_stream_pool_speed_test)
 stest(reassembler_speed_test)
+stest(reassembler_pattern_speed_test)
+stest(wrapping_integers_speed_test)
+stest(sender_speed_test)
+stest(congestion_speed_test)
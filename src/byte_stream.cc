@@ -1,50 +1,401 @@
 #include "byte_stream.hh"
 
-#include <cmath>
+#include <algorithm>
+#include <bit>
+#include <cstring>
 #include <stdexcept>
 
 using namespace std;
 
-ByteStream::ByteStream(uint64_t capacity) : capacity_(capacity), bytes_() {}
+ByteStream::ByteStream(uint64_t capacity, Storage storage)
+    : capacity_(capacity), storage_(storage), state_(make_state(storage)) {
+  if (storage_ == Storage::spsc) {
+    reserve(capacity_);
+  }
+}
+
+ByteStream::State ByteStream::make_state(Storage storage) {
+  switch (storage) {
+    case Storage::chunked:
+      return ChunkedState{};
+    case Storage::spsc:
+      return SpscState{};
+    case Storage::pooled:
+      return PooledState{};
+    case Storage::ring:
+      break;
+  }
+  return RingState{};
+}
+
+string &ByteStream::ring() {
+  return storage_ == Storage::spsc ? state<SpscState>().buffer
+                                   : state<RingState>().buffer;
+}
+
+const string &ByteStream::ring() const {
+  return storage_ == Storage::spsc ? state<SpscState>().buffer
+                                   : state<RingState>().buffer;
+}
+
+uint64_t ByteStream::load_pushed() const {
+  return storage_ == Storage::spsc
+             ? state<SpscState>().counters->bytes_pushed.load()
+             : bytes_pushed_;
+}
+
+void ByteStream::store_pushed(uint64_t pushed) {
+  if (storage_ == Storage::spsc) {
+    state<SpscState>().counters->bytes_pushed.store(pushed);
+  } else {
+    bytes_pushed_ = pushed;
+  }
+}
+
+uint64_t ByteStream::load_popped() const {
+  return storage_ == Storage::spsc
+             ? state<SpscState>().counters->bytes_popped.load()
+             : bytes_popped_;
+}
+
+void ByteStream::store_popped(uint64_t popped) {
+  if (storage_ == Storage::spsc) {
+    state<SpscState>().counters->bytes_popped.store(popped);
+  } else {
+    bytes_popped_ = popped;
+  }
+}
+
+bool ByteStream::load_closed() const {
+  return storage_ == Storage::spsc ? state<SpscState>().counters->closed.load()
+                                   : closed_;
+}
+
+void ByteStream::reserve(uint64_t len) {
+  const uint64_t size = ring().size();
+  if (len <= size) {
+    return;
+  }
+
+  // Doubling never overshoots bit_ceil(capacity_), since the old size is a
+  // power of two below `len` <= capacity_.
+  resize_ring(std::max(std::bit_ceil(len), size * 2));
+}
+
+void ByteStream::resize_ring(uint64_t new_size) {
+  string &buffer = ring();
+  string new_buffer(new_size, 0);
+
+  // Re-home every buffered byte at its position modulo the new size
+  const uint64_t old_mask = buffer.size() - 1;
+  const uint64_t new_mask = new_size - 1;
+  const uint64_t pushed = load_pushed();
+  uint64_t index = load_popped();
+  while (index < pushed) {
+    const uint64_t len_now =
+        std::min({pushed - index, buffer.size() - (index & old_mask),
+                  new_size - (index & new_mask)});
+    memcpy(new_buffer.data() + (index & new_mask),
+           buffer.data() + (index & old_mask), len_now);
+    index += len_now;
+  }
+
+  buffer = std::move(new_buffer);
+}
+
+void ByteStream::reserve_chunks(uint64_t end) {
+  PooledState &pooled = state<PooledState>();
+  while (pooled.base + pooled.chunks.size() * ChunkPool::kChunkSize < end) {
+    pooled.chunks.emplace_back();
+  }
+}
+
+span<char> ByteStream::chunk_span(uint64_t index) {
+  PooledState &pooled = state<PooledState>();
+  const uint64_t offset = index - pooled.base;
+  const uint64_t in_chunk = offset % ChunkPool::kChunkSize;
+  return {pooled.chunks[offset / ChunkPool::kChunkSize].data() + in_chunk,
+          ChunkPool::kChunkSize - in_chunk};
+}
+
+string_view ByteStream::chunk_span(uint64_t index) const {
+  const PooledState &pooled = state<PooledState>();
+  const uint64_t offset = index - pooled.base;
+  const uint64_t in_chunk = offset % ChunkPool::kChunkSize;
+  return {pooled.chunks[offset / ChunkPool::kChunkSize].data() + in_chunk,
+          ChunkPool::kChunkSize - in_chunk};
+}
 
 void Writer::push(string data) {
-  int64_t bytes_pushed =
-      std::min(static_cast<int64_t>(data.size()),
-               static_cast<int64_t>(capacity_ - bytes_.size()));
-  bytes_pushed_ += bytes_pushed;
-  bytes_.insert(bytes_.end(), data.begin(), data.begin() + bytes_pushed);
+  const uint64_t len = std::min(static_cast<uint64_t>(data.size()),
+                                available_capacity());
+  if (len == 0) {
+    return;
+  }
+
+  const uint64_t pushed = load_pushed();
+  if (storage_ == Storage::chunked) {
+    data.resize(len);
+    state<ChunkedState>().chunks.emplace_back(std::move(data));
+    store_pushed(pushed + len);
+    return;
+  }
+
+  if (storage_ == Storage::pooled) {
+    reserve_chunks(pushed + len);
+    for (uint64_t copied = 0; copied < len;) {
+      const auto dest = chunk_span(pushed + copied);
+      const uint64_t len_now = std::min(len - copied, dest.size());
+      memcpy(dest.data(), data.data() + copied, len_now);
+      copied += len_now;
+    }
+    store_pushed(pushed + len);
+    return;
+  }
+
+  reserve(pushed + len - load_popped());
+
+  // Copy in at most two pieces: up to the end of the ring, then the wrap
+  string &buffer = ring();
+  const uint64_t tail = pushed & (buffer.size() - 1);
+  const uint64_t first_len = std::min(len, buffer.size() - tail);
+  memcpy(buffer.data() + tail, data.data(), first_len);
+  memcpy(buffer.data(), data.data() + first_len, len - first_len);
+
+  // Publish the bytes to the reader
+  store_pushed(pushed + len);
 }
 
-void Writer::close() { closed_ = true; }
+void Writer::push(const Buffer &data, uint64_t offset, uint64_t len) {
+  const string_view bytes = string_view{data}.substr(offset, len);
+  if (storage_ == Storage::chunked and bytes.size() == data.size() and
+      bytes.size() <= available_capacity()) {
+    if (not bytes.empty()) {
+      state<ChunkedState>().chunks.push_back(data);
+      store_pushed(load_pushed() + bytes.size());
+    }
+    return;
+  }
 
-void Writer::set_error() { has_error_ = true; }
+  // Otherwise copy once, straight into the stream's free space
+  uint64_t copied = 0;
+  for (const auto dest : writable_spans(bytes.size())) {
+    copied += bytes.copy(dest.data(), dest.size(), copied);
+  }
+  commit(copied);
+}
 
-bool Writer::is_closed() const { return closed_; }
+vector<span<char>> Writer::writable_spans(uint64_t len) {
+  len = std::min(len, available_capacity());
+  if (len == 0) {
+    return {};
+  }
+
+  if (storage_ == Storage::chunked) {
+    string &pending = state<ChunkedState>().pending;
+    pending.resize(len);
+    return {span<char>{pending}};
+  }
+
+  const uint64_t pushed = load_pushed();
+  if (storage_ == Storage::pooled) {
+    reserve_chunks(pushed + len);
+    vector<span<char>> spans;
+    for (uint64_t covered = 0; covered < len;) {
+      const auto dest = chunk_span(pushed + covered);
+      spans.push_back(dest.first(std::min(len - covered, dest.size())));
+      covered += spans.back().size();
+    }
+    return spans;
+  }
+
+  reserve(pushed + len - load_popped());
+
+  string &buffer = ring();
+  const uint64_t tail = pushed & (buffer.size() - 1);
+  const uint64_t first_len = std::min(len, buffer.size() - tail);
+  vector<span<char>> spans{span<char>{buffer.data() + tail, first_len}};
+  if (first_len < len) {
+    spans.emplace_back(buffer.data(), len - first_len);
+  }
+  return spans;
+}
+
+void Writer::commit(uint64_t len) {
+  if (storage_ == Storage::chunked) {
+    ChunkedState &chunked = state<ChunkedState>();
+    len = std::min(len, static_cast<uint64_t>(chunked.pending.size()));
+    chunked.pending.resize(len);
+    if (len != 0) {
+      chunked.chunks.emplace_back(std::move(chunked.pending));
+    }
+    chunked.pending = {};
+  } else {
+    len = std::min(len, available_capacity());
+  }
+
+  store_pushed(load_pushed() + len);
+}
+
+void Writer::close() {
+  if (storage_ == Storage::spsc) {
+    state<SpscState>().counters->closed.store(true);
+  } else {
+    closed_ = true;
+  }
+}
+
+void Writer::set_error() { has_error_.store(true); }
+
+bool Writer::is_closed() const { return load_closed(); }
+
+uint64_t Writer::capacity() const { return capacity_; }
+
+void Writer::set_capacity(uint64_t capacity) {
+  const uint64_t buffered = load_pushed() - load_popped();
+  capacity = std::max(capacity, buffered);
+  if (storage_ == Storage::spsc) {
+    capacity_ = std::min(capacity, static_cast<uint64_t>(ring().size()));
+    return;
+  }
+  capacity_ = capacity;
+
+  // A ring that grew for a larger capacity shrinks to what is buffered now,
+  // and grows again on demand
+  if (storage_ == Storage::ring and ring().size() > std::bit_ceil(capacity_)) {
+    resize_ring(buffered == 0 ? 0 : std::bit_ceil(buffered));
+  }
+}
 
 uint64_t Writer::available_capacity() const {
-  return capacity_ - bytes_.size();
+  return capacity_ - (load_pushed() - load_popped());
 }
 
-uint64_t Writer::bytes_pushed() const { return bytes_pushed_; }
+uint64_t Writer::bytes_pushed() const { return load_pushed(); }
 
-string Reader::peek() const { return string(bytes_.begin(), bytes_.end()); }
+string_view Reader::peek() const {
+  const uint64_t buffered = bytes_buffered();
+  if (buffered == 0) {
+    return {};
+  }
+  if (storage_ == Storage::chunked) {
+    const ChunkedState &chunked = state<ChunkedState>();
+    return string_view{chunked.chunks.front()}.substr(chunked.head);
+  }
+  if (storage_ == Storage::pooled) {
+    return chunk_span(load_popped()).substr(0, buffered);
+  }
+  const string &buffer = ring();
+  const uint64_t head = load_popped() & (buffer.size() - 1);
+  return {buffer.data() + head, std::min(buffered, buffer.size() - head)};
+}
+
+vector<string_view> Reader::peek_spans(size_t max_spans) const {
+  vector<string_view> spans;
+  uint64_t remaining = bytes_buffered();
+  if (remaining == 0 or max_spans == 0) {
+    return spans;
+  }
+
+  if (storage_ == Storage::chunked) {
+    const ChunkedState &chunked = state<ChunkedState>();
+    uint64_t skip = chunked.head;
+    for (auto it = chunked.chunks.begin();
+         it != chunked.chunks.end() and spans.size() < max_spans; ++it) {
+      spans.push_back(string_view{*it}.substr(skip));
+      skip = 0;
+    }
+    return spans;
+  }
+
+  if (storage_ == Storage::pooled) {
+    for (uint64_t index = load_popped();
+         remaining != 0 and spans.size() < max_spans;) {
+      spans.push_back(chunk_span(index).substr(0, remaining));
+      index += spans.back().size();
+      remaining -= spans.back().size();
+    }
+    return spans;
+  }
+
+  // The readable region of a ring wraps around at most once
+  const string &buffer = ring();
+  const uint64_t head = load_popped() & (buffer.size() - 1);
+  const uint64_t first_len = std::min(remaining, buffer.size() - head);
+  spans.emplace_back(buffer.data() + head, first_len);
+  remaining -= first_len;
+  if (remaining != 0 and max_spans > 1) {
+    spans.emplace_back(buffer.data(), remaining);
+  }
+  return spans;
+}
 
 bool Reader::is_finished() const {
-  if (!closed_) {
+  if (!load_closed()) {
     return false;
   }
-  return bytes_.empty();
+  return bytes_buffered() == 0;
 }
 
-bool Reader::has_error() const { return has_error_; }
+bool Reader::has_error() const { return has_error_.load(); }
 
 void Reader::pop(uint64_t len) {
-  uint64_t bytes_popped = std::min(len, bytes_.size());
-  bytes_.erase(bytes_.begin(),
-               bytes_.begin() + static_cast<int64_t>(bytes_popped));
-  bytes_popped_ += bytes_popped;
+  len = std::min(len, bytes_buffered());
+  if (storage_ == Storage::chunked) {
+    ChunkedState &chunked = state<ChunkedState>();
+    chunked.head += len;
+    while (not chunked.chunks.empty() and
+           chunked.head >= chunked.chunks.front().size()) {
+      chunked.head -= chunked.chunks.front().size();
+      chunked.chunks.pop_front();
+    }
+  }
+
+  // Hand the space back to the writer
+  const uint64_t popped = load_popped() + len;
+  store_popped(popped);
+
+  if (storage_ == Storage::pooled) {
+    // Return fully-read chunks to the pool, and everything once drained
+    PooledState &pooled = state<PooledState>();
+    if (popped == load_pushed()) {
+      pooled.chunks.clear();
+      pooled.base = popped;
+    }
+    while (not pooled.chunks.empty() and
+           pooled.base + ChunkPool::kChunkSize <= popped) {
+      pooled.chunks.pop_front();
+      pooled.base += ChunkPool::kChunkSize;
+    }
+  }
 }
 
-uint64_t Reader::bytes_buffered() const { return bytes_.size(); }
+Buffer Reader::pop_buffer(uint64_t len) {
+  len = std::min(len, bytes_buffered());
+  if (storage_ == Storage::chunked) {
+    const ChunkedState &chunked = state<ChunkedState>();
+    if (chunked.head == 0 and not chunked.chunks.empty() and
+        chunked.chunks.front().size() == len) {
+      Buffer chunk = chunked.chunks.front();
+      pop(len);
+      return chunk;
+    }
+  }
+
+  string out;
+  out.reserve(len);
+  for (string_view span : peek_spans()) {
+    if (out.size() == len) {
+      break;
+    }
+    out += span.substr(0, len - out.size());
+  }
+  pop(len);
+  return Buffer{std::move(out)};
+}
+
+uint64_t Reader::bytes_buffered() const {
+  return load_pushed() - load_popped();
+}
 
-uint64_t Reader::bytes_popped() const { return bytes_popped_; }
+uint64_t Reader::bytes_popped() const { return load_popped(); }
@@ -1,26 +1,153 @@
 #pragma once
 
-#include <queue>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <span>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <variant>
+#include <vector>
+
+#include "buffer.hh"
+#include "chunk_pool.hh"
 
 class Reader;
 class Writer;
 
 class ByteStream {
+ public:
+  // How the ByteStream holds its buffered bytes
+  enum class Storage {
+    ring,     // copy pushed bytes into one contiguous ring buffer
+    chunked,  // keep each pushed string, moved in as-is, in a queue of chunks
+    spsc,     // ring buffer allocated up front, so that one thread may use
+              // the Writer while another uses the Reader
+    pooled,   // fixed-size chunks borrowed from ChunkPool::global() and given
+              // back as soon as they are popped
+  };
+
  protected:
+  // A value written by one side of the stream and read by the other. Stores
+  // publish with release semantics and loads acquire, which is free on x86
+  // and makes the ring safe to share between a producer and a consumer
+  // thread. Copying takes a snapshot, so a ByteStream stays copyable.
+  template <typename T>
+  class Shared {
+    std::atomic<T> value_;
+
+   public:
+    // NOLINTNEXTLINE(*-explicit-*)
+    Shared(T value = {}) : value_(value) {}
+    Shared(const Shared &other) : value_(other.load()) {}
+    Shared &operator=(const Shared &other) {
+      store(other.load());
+      return *this;
+    }
+    ~Shared() = default;
+
+    T load() const { return value_.load(std::memory_order_acquire); }
+    void store(T value) { value_.store(value, std::memory_order_release); }
+  };
+
   uint64_t capacity_;
+  Storage storage_;
   // Please add any additional state to the ByteStream here, and not to the
   // Writer and Reader interfaces.
-  std::deque<char> bytes_;
+
+  // Storage::ring. Byte `i` of the stream lives at `buffer[i & (size - 1)]`,
+  // where the size is zero or a power of two. It grows on demand up to the
+  // next power of two above `capacity_`.
+  struct RingState {
+    std::string buffer{};
+  };
+  // Storage::chunked. `head` bytes of the front chunk have already been
+  // popped, and `pending` is the space handed out by
+  // Writer::writable_spans(), which becomes a chunk on Writer::commit().
+  struct ChunkedState {
+    std::deque<Buffer> chunks{};
+    uint64_t head = 0;
+    std::string pending{};
+  };
+  // Storage::spsc: a ring sized in the constructor, with counters of its own
+  // that keep the producer's and the consumer's state on separate cache
+  // lines, so the two threads don't false-share. They are boxed so that no
+  // other mode pays for the padding.
+  struct SpscState {
+    static constexpr size_t kCacheLineSize = 64;
+    struct alignas(kCacheLineSize) Counters {
+      Shared<uint64_t> bytes_pushed = 0;  // producer
+      Shared<bool> closed = false;
+      alignas(kCacheLineSize) Shared<uint64_t> bytes_popped = 0;  // consumer
+    };
+
+    std::string buffer{};
+    std::unique_ptr<Counters> counters = std::make_unique<Counters>();
+
+    SpscState() = default;
+    SpscState(const SpscState &other)
+        : buffer(other.buffer),
+          counters(std::make_unique<Counters>(*other.counters)) {}
+    SpscState &operator=(const SpscState &other) {
+      buffer = other.buffer;
+      counters = std::make_unique<Counters>(*other.counters);
+      return *this;
+    }
+    SpscState(SpscState &&other) noexcept = default;
+    SpscState &operator=(SpscState &&other) noexcept = default;
+    ~SpscState() = default;
+  };
+  // Storage::pooled. Chunk `k` holds the stream bytes starting at index
+  // `base + k * ChunkPool::kChunkSize`.
+  struct PooledState {
+    std::deque<PooledChunk> chunks{};
+    uint64_t base = 0;
+  };
+  using State = std::variant<RingState, ChunkedState, SpscState, PooledState>;
+  State state_;
+  static State make_state(Storage storage);
+
+  Shared<bool> has_error_ = false;
+  // The counters of every mode but Storage::spsc, which only one thread uses
+  uint64_t bytes_pushed_ = 0;
   bool closed_ = false;
-  bool has_error_ = false;
   uint64_t bytes_popped_ = 0;
-  uint64_t bytes_pushed_ = 0;
+
+  // The state of the current mode, and the ring of a ring or spsc stream
+  template <typename Mode>
+  Mode &state() {
+    return *std::get_if<Mode>(&state_);
+  }
+  template <typename Mode>
+  const Mode &state() const {
+    return *std::get_if<Mode>(&state_);
+  }
+  std::string &ring();
+  const std::string &ring() const;
+  // This mode's counters, atomic only for Storage::spsc
+  uint64_t load_pushed() const;
+  void store_pushed(uint64_t pushed);
+  uint64_t load_popped() const;
+  void store_popped(uint64_t popped);
+  bool load_closed() const;
+
+  // Grow the ring buffer so that it can hold at least `len` bytes. Never
+  // called concurrently: a Storage::spsc ring is sized in the constructor.
+  void reserve(uint64_t len);
+  // Move the buffered bytes into a ring of `new_size` (zero or a power of two
+  // no smaller than bytes buffered)
+  void resize_ring(uint64_t new_size);
+
+  // Borrow pooled chunks until they reach stream index `end`
+  void reserve_chunks(uint64_t end);
+  // The rest of the pooled chunk holding stream index `index`
+  std::span<char> chunk_span(uint64_t index);
+  std::string_view chunk_span(uint64_t index) const;
 
  public:
-  explicit ByteStream(uint64_t capacity);
+  explicit ByteStream(uint64_t capacity, Storage storage = Storage::ring);
 
   // Helper functions (provided) to access the ByteStream's Reader and Writer
   // interfaces
@@ -34,22 +161,49 @@ class Writer : public ByteStream {
  public:
   void push(std::string data);  // Push data to stream, but only as much as
                                 // available capacity allows.
+  // Push bytes [offset, offset + len) of a shared payload. A chunked stream
+  // keeps a reference to the whole payload instead of copying it when the
+  // slice covers all of it and fits.
+  void push(const Buffer &data, uint64_t offset, uint64_t len);
 
   void close();  // Signal that the stream has reached its ending. Nothing more
                  // will be written.
   void set_error();  // Signal that the stream suffered an error.
 
   bool is_closed() const;  // Has the stream been closed?
+  uint64_t capacity() const;  // How many bytes can the stream hold at most?
+  // Change the capacity, though never below the bytes already buffered. A
+  // ring gives back memory it no longer needs. A Storage::spsc stream can't
+  // grow past the ring it was created with.
+  void set_capacity(uint64_t capacity);
   uint64_t available_capacity()
       const;  // How many bytes can be pushed to the stream right now?
   uint64_t bytes_pushed()
       const;  // Total number of bytes cumulatively pushed to the stream
+
+  // Scatter-gather writes (e.g. readv(2) straight into the stream): expose up
+  // to `len` bytes of free space, at most as much as available capacity
+  // allows, then commit() however many of those bytes were filled in. Any
+  // other call on the Writer, or a pop() from a Storage::pooled stream,
+  // invalidates the spans.
+  std::vector<std::span<char>> writable_spans(uint64_t len);
+  void commit(uint64_t len);  // Push the first `len` bytes of writable_spans()
 };
 
 class Reader : public ByteStream {
  public:
-  std::string peek() const;  // Peek at the next bytes in the buffer
+  std::string_view peek() const;  // Peek at the next contiguous bytes in the
+                                  // buffer (may be fewer than buffered)
   void pop(uint64_t len);    // Remove `len` bytes from the buffer
+  // Remove up to `len` bytes and return them as one Buffer. A chunked
+  // stream whose front chunk is exactly those bytes hands the chunk itself
+  // over; otherwise they are copied once, into a Buffer of just that size.
+  Buffer pop_buffer(uint64_t len);
+
+  // Scatter-gather reads (e.g. writev(2) straight from the stream): up to
+  // `max_spans` views that together cover the buffered bytes in order. They
+  // stay valid until the next pop() or write to the stream.
+  std::vector<std::string_view> peek_spans(size_t max_spans = SIZE_MAX) const;
 
   bool is_finished()
       const;               // Is the stream finished (closed and fully popped)?
@@ -0,0 +1,195 @@
+#include "chunk_pool.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <utility>
+
+using namespace std;
+
+ChunkPool &ChunkPool::global() {
+  // Never destroyed, so streams with static storage duration can still
+  // return their chunks at exit
+  static auto *pool = new ChunkPool;  // NOLINT(*-owning-memory)
+  return *pool;
+}
+
+// A thread's cached free chunks, which go back to their pool when the thread
+// exits. Only one pool (the first the thread uses) is cached for.
+struct ChunkPool::ThreadCache {
+  ChunkPool *pool = nullptr;
+  std::vector<char *> chunks{};
+
+  ThreadCache() = default;
+  ThreadCache(const ThreadCache &) = delete;
+  ThreadCache &operator=(const ThreadCache &) = delete;
+  ThreadCache(ThreadCache &&) = delete;
+  ThreadCache &operator=(ThreadCache &&) = delete;
+  ~ThreadCache();
+};
+
+namespace {
+// Trivially destructible, so still readable while thread-local and static
+// objects destroyed after the cache return their chunks
+thread_local bool cache_destroyed = false;
+}  // namespace
+
+ChunkPool::ThreadCache::~ThreadCache() {
+  if (pool != nullptr) {
+    pool->drain(chunks, 0);
+  }
+  cache_destroyed = true;
+}
+
+ChunkPool::ThreadCache *ChunkPool::thread_cache() {
+  if (cache_destroyed) {
+    return nullptr;
+  }
+  thread_local ThreadCache cache;
+  return &cache;
+}
+
+void ChunkPool::refill(vector<char *> &cache, size_t count) {
+  const lock_guard lock{mutex_};
+  if (free_chunks_.size() < count) {
+    // NOLINTNEXTLINE(*-avoid-c-arrays)
+    auto &slab = slabs_.emplace_back(
+        make_unique<char[]>(kChunkSize * kChunksPerSlab));
+    for (size_t i = kChunksPerSlab; i > 0; --i) {
+      free_chunks_.push_back(slab.get() + (i - 1) * kChunkSize);
+    }
+  }
+  const size_t len = min(count, free_chunks_.size());
+  cache.insert(cache.end(), free_chunks_.end() - static_cast<ptrdiff_t>(len),
+               free_chunks_.end());
+  free_chunks_.resize(free_chunks_.size() - len);
+}
+
+void ChunkPool::drain(vector<char *> &cache, size_t keep) {
+  if (cache.size() <= keep) {
+    return;
+  }
+  const lock_guard lock{mutex_};
+  free_chunks_.insert(free_chunks_.end(),
+                      cache.begin() + static_cast<ptrdiff_t>(keep),
+                      cache.end());
+  cache.resize(keep);
+}
+
+void ChunkPool::count_acquired() {
+  const uint64_t in_use =
+      chunks_in_use_.fetch_add(1, memory_order_relaxed) + 1;
+  uint64_t high = high_water_mark_.load(memory_order_relaxed);
+  while (in_use > high and not high_water_mark_.compare_exchange_weak(
+                               high, in_use, memory_order_relaxed)) {
+  }
+}
+
+char *ChunkPool::acquire() {
+  ThreadCache *cache = thread_cache();
+  if (cache != nullptr and cache->pool == nullptr) {
+    cache->pool = this;
+  }
+  vector<char *> uncached;
+  vector<char *> &chunks =
+      cache != nullptr and cache->pool == this ? cache->chunks : uncached;
+  if (chunks.empty()) {
+    refill(chunks, &chunks == &uncached ? 1 : kCacheBatch);
+  }
+
+  char *chunk = chunks.back();
+  chunks.pop_back();
+  count_acquired();
+  return chunk;
+}
+
+void ChunkPool::release(char *chunk) {
+  chunks_in_use_.fetch_sub(1, memory_order_relaxed);
+  ThreadCache *cache = thread_cache();
+  if (cache != nullptr and cache->pool == this) {
+    cache->chunks.push_back(chunk);
+    // Keep a batch on hand either way, so a thread that alternates between
+    // acquiring and releasing doesn't take the lock every time
+    if (cache->chunks.size() >= 2 * kCacheBatch) {
+      drain(cache->chunks, kCacheBatch);
+    }
+    return;
+  }
+  const lock_guard lock{mutex_};
+  free_chunks_.push_back(chunk);
+}
+
+size_t ChunkPool::trim() {
+  ThreadCache *cache = thread_cache();
+  if (cache != nullptr and cache->pool == this) {
+    drain(cache->chunks, 0);
+  }
+
+  const lock_guard lock{mutex_};
+  sort(free_chunks_.begin(), free_chunks_.end());
+  const auto free_in = [&](const char *begin, const char *end) {
+    return lower_bound(free_chunks_.begin(), free_chunks_.end(), end) -
+           lower_bound(free_chunks_.begin(), free_chunks_.end(), begin);
+  };
+
+  // Slabs with every chunk free go, along with those chunks
+  vector<pair<const char *, const char *>> freed;  // [begin, end)
+  for (const auto &slab : slabs_) {
+    const char *begin = slab.get();
+    const char *end = begin + kChunkSize * kChunksPerSlab;
+    if (static_cast<size_t>(free_in(begin, end)) == kChunksPerSlab) {
+      freed.emplace_back(begin, end);
+    }
+  }
+  sort(freed.begin(), freed.end());
+  const auto in_freed = [&](const char *chunk) {
+    const auto after = upper_bound(
+        freed.begin(), freed.end(), chunk,
+        [](const char *c, const auto &range) { return c < range.first; });
+    return after != freed.begin() and chunk < prev(after)->second;
+  };
+  erase_if(free_chunks_, in_freed);
+  erase_if(slabs_, [&](const auto &slab) { return in_freed(slab.get()); });
+  return freed.size();
+}
+
+uint64_t ChunkPool::chunks_in_use() const {
+  return chunks_in_use_.load(memory_order_relaxed);
+}
+
+uint64_t ChunkPool::high_water_mark() const {
+  return high_water_mark_.load(memory_order_relaxed);
+}
+
+uint64_t ChunkPool::chunks_allocated() const {
+  const lock_guard lock{mutex_};
+  return slabs_.size() * kChunksPerSlab;
+}
+
+PooledChunk::~PooledChunk() {
+  if (data_) {
+    ChunkPool::global().release(data_);
+  }
+}
+
+PooledChunk::PooledChunk(const PooledChunk &other) : PooledChunk() {
+  memcpy(data_, other.data_, ChunkPool::kChunkSize);
+}
+
+PooledChunk &PooledChunk::operator=(const PooledChunk &other) {
+  if (this != &other) {
+    if (not data_) {
+      data_ = ChunkPool::global().acquire();
+    }
+    memcpy(data_, other.data_, ChunkPool::kChunkSize);
+  }
+  return *this;
+}
+
+PooledChunk::PooledChunk(PooledChunk &&other) noexcept
+    : data_(exchange(other.data_, nullptr)) {}
+
+PooledChunk &PooledChunk::operator=(PooledChunk &&other) noexcept {
+  swap(data_, other.data_);
+  return *this;
+}
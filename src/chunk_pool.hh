@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// A process-wide slab allocator of fixed-size chunks, shared by every
+// ByteStream that uses Storage::pooled. Chunks are carved out of large slabs
+// and recycled through a free list, so a busy stream never calls malloc in
+// steady state and an idle stream holds no chunks at all.
+//
+// Each thread keeps a small cache of free chunks in front of the shared free
+// list, and moves them to and from it kCacheBatch at a time, so streams on
+// different threads take the pool's lock only once per batch.
+class ChunkPool {
+ public:
+  static constexpr size_t kChunkSize = 4096;
+  static constexpr size_t kChunksPerSlab = 64;
+  static constexpr size_t kCacheBatch = 32;
+
+  // The pool shared by all streams in the process
+  static ChunkPool &global();
+
+  char *acquire();            // Take a chunk of kChunkSize bytes
+  void release(char *chunk);  // Give a chunk back to the free list
+
+  // Return this thread's cached chunks to the shared free list, then free
+  // every slab whose chunks are all on it. Returns how many slabs were freed.
+  size_t trim();
+
+  uint64_t chunks_in_use() const;     // Chunks currently held by streams
+  uint64_t high_water_mark() const;   // Most chunks ever in use at once
+  uint64_t chunks_allocated() const;  // Chunks carved from slabs and not
+                                      // yet trimmed
+
+ private:
+  struct ThreadCache;
+  static ThreadCache *thread_cache();
+  // Move `count` free chunks into `cache`, or all but `keep` back out
+  void refill(std::vector<char *> &cache, size_t count);
+  void drain(std::vector<char *> &cache, size_t keep);
+  void count_acquired();
+
+  mutable std::mutex mutex_{};
+  std::vector<std::unique_ptr<char[]>> slabs_{};  // NOLINT(*-avoid-c-arrays)
+  std::vector<char *> free_chunks_{};
+  std::atomic<uint64_t> chunks_in_use_ = 0;
+  std::atomic<uint64_t> high_water_mark_ = 0;
+};
+
+// A chunk borrowed from ChunkPool::global() and returned on destruction.
+// Copying borrows a new chunk and copies the contents.
+class PooledChunk {
+  char *data_;
+
+ public:
+  PooledChunk() : data_(ChunkPool::global().acquire()) {}
+  ~PooledChunk();
+
+  PooledChunk(const PooledChunk &other);
+  PooledChunk &operator=(const PooledChunk &other);
+  PooledChunk(PooledChunk &&other) noexcept;
+  PooledChunk &operator=(PooledChunk &&other) noexcept;
+
+  char *data() { return data_; }
+  const char *data() const { return data_; }
+};
@@ -0,0 +1,224 @@
+#include "congestion_control.hh"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+void Cubic::avoid_congestion(const AckEvent& ack) {
+  const double mss = static_cast<double>(mss_);
+  const double cwnd = static_cast<double>(cwnd_) / mss;
+  if (!epoch_start_ms_.has_value()) {
+    epoch_start_ms_ = ack.now_ms;
+    k_ = w_max_ > cwnd ? cbrt((w_max_ - cwnd) / kC) : 0;
+    w_max_ = max(w_max_, cwnd);
+    w_est_ = cwnd;
+  }
+
+  const auto w_cubic = [this](double t) {
+    return kC * pow(t - k_, 3) + w_max_;
+  };
+  const double t =
+      static_cast<double>(ack.now_ms - *epoch_start_ms_) / 1000.0;
+  const double rtt =
+      min_rtt_ms_ == UINT64_MAX ? 0 : static_cast<double>(min_rtt_ms_) / 1000.0;
+  const double segments_acked = static_cast<double>(ack.acked) / mss;
+
+  // Reno-friendly region: grow at least as fast as Reno with the same beta
+  constexpr double alpha = 3 * (1 - kBeta) / (1 + kBeta);
+  w_est_ += alpha * segments_acked / cwnd;
+  double target = 0;
+  if (w_cubic(t) < w_est_) {
+    target = w_est_;
+  } else {
+    target = clamp(w_cubic(t + rtt), cwnd, 1.5 * cwnd);
+  }
+
+  // Close (target - cwnd) / cwnd segments per segment acknowledged
+  partial_bytes_ += max(0.0, target - cwnd) / cwnd * segments_acked * mss;
+  const double whole = floor(partial_bytes_);
+  cwnd_ += static_cast<uint64_t>(whole);
+  partial_bytes_ -= whole;
+}
+
+uint64_t Cubic::reduce() {
+  const double cwnd = static_cast<double>(cwnd_) / static_cast<double>(mss_);
+  // Fast convergence: give up bandwidth sooner when losses come earlier
+  w_max_ = cwnd < w_max_ ? cwnd * (1 + kBeta) / 2 : cwnd;
+  epoch_start_ms_.reset();
+  partial_bytes_ = 0;
+  return max(static_cast<uint64_t>(static_cast<double>(cwnd_) * kBeta),
+             2 * mss_);
+}
+
+void WindowedMaxFilter::update(uint64_t time, double sample) {
+  // A candidate no larger than a newer sample can never be the max again
+  while (!samples_.empty() && samples_.back().second <= sample) {
+    samples_.pop_back();
+  }
+  samples_.emplace_back(time, sample);
+  while (samples_.front().first + window_ <= time) {
+    samples_.pop_front();
+  }
+}
+
+namespace {
+
+// probe_bw's pacing gains, one per min RTT: probe for more bandwidth, drain
+// the queue that built, then cruise
+constexpr array<double, 8> kPacingGainCycle{1.25, 0.75, 1, 1, 1, 1, 1, 1};
+
+}  // namespace
+
+void BBR::update_model(const AckEvent& ack, bool min_rtt_expired) {
+  round_start_ = false;
+  if (ack.prior_delivered >= next_round_delivered_) {
+    next_round_delivered_ = ack.delivered;
+    ++round_count_;
+    round_start_ = true;
+  }
+
+  if (ack.delivery_rate.has_value()) {
+    bandwidth_.update(round_count_, *ack.delivery_rate);
+  }
+
+  if (ack.rtt_ms.has_value() &&
+      (!min_rtt_ms_.has_value() || *ack.rtt_ms <= *min_rtt_ms_ ||
+       min_rtt_expired)) {
+    min_rtt_ms_ = ack.rtt_ms;
+    min_rtt_stamp_ms_ = ack.now_ms;
+  }
+}
+
+void BBR::check_full_pipe() {
+  const double bandwidth = bandwidth_.best();
+  if (bandwidth >= full_bandwidth_ * 1.25) {
+    full_bandwidth_ = bandwidth;
+    full_bandwidth_rounds_ = 0;
+    return;
+  }
+  if (++full_bandwidth_rounds_ >= 3) {
+    filled_pipe_ = true;
+  }
+}
+
+void BBR::update_cycle_phase(const AckEvent& ack, uint64_t in_flight) {
+  const double gain = kPacingGainCycle[cycle_index_];
+  const bool full_length =
+      ack.now_ms - cycle_stamp_ms_ > min_rtt_ms_.value_or(0);
+  bool advance = full_length;
+  if (gain > 1) {
+    // Probe until the extra data is really in flight, or something is lost
+    advance = full_length &&
+              (in_recovery() || ack.bytes_in_flight >= bdp(gain));
+  } else if (gain < 1) {
+    // Drain no longer than it takes to empty the queue
+    advance = full_length || in_flight <= bdp(1);
+  }
+  if (advance) {
+    cycle_index_ = (cycle_index_ + 1) % kPacingGainCycle.size();
+    cycle_stamp_ms_ = ack.now_ms;
+    pacing_gain_ = kPacingGainCycle[cycle_index_];
+  }
+}
+
+void BBR::enter_probe_bw(uint64_t now_ms) {
+  state_ = State::probe_bw;
+  cwnd_gain_ = kCwndGain;
+  // Start cruising, so the first probe comes after the queue has drained
+  cycle_index_ = 2;
+  cycle_stamp_ms_ = now_ms;
+  pacing_gain_ = kPacingGainCycle[cycle_index_];
+}
+
+void BBR::handle_probe_rtt(const AckEvent& ack, uint64_t in_flight) {
+  if (!probe_rtt_done_ms_.has_value()) {
+    // Hold the minimum in flight for kProbeRttMs and at least one round
+    if (in_flight <= kMinCwndSegments * mss_) {
+      probe_rtt_done_ms_ = ack.now_ms + kProbeRttMs;
+      probe_rtt_round_done_ = false;
+      next_round_delivered_ = ack.delivered;
+    }
+    return;
+  }
+  if (round_start_) {
+    probe_rtt_round_done_ = true;
+  }
+  if (probe_rtt_round_done_ && ack.now_ms >= *probe_rtt_done_ms_) {
+    min_rtt_stamp_ms_ = ack.now_ms;
+    cwnd_ = max(cwnd_, prior_cwnd_);
+    if (filled_pipe_) {
+      enter_probe_bw(ack.now_ms);
+    } else {
+      state_ = State::startup;
+      pacing_gain_ = kHighGain;
+      cwnd_gain_ = kHighGain;
+    }
+  }
+}
+
+void BBR::set_cwnd(const AckEvent& ack) {
+  // Allow a few segments over the target for delayed and stretched ACKs
+  const uint64_t target = bdp(cwnd_gain_) + 3 * mss_;
+  if (filled_pipe_) {
+    cwnd_ = min(cwnd_ + ack.acked, target);
+  } else if (cwnd_ < target ||
+             ack.delivered < TCPConfig::INITIAL_CWND_SEGMENTS * mss_) {
+    cwnd_ += ack.acked;
+  }
+  cwnd_ = max(cwnd_, kMinCwndSegments * mss_);
+  if (state_ == State::probe_rtt) {
+    cwnd_ = min(cwnd_, kMinCwndSegments * mss_);
+  }
+}
+
+uint64_t BBR::bdp(double gain) const {
+  const double bandwidth = bandwidth_.best();
+  if (!min_rtt_ms_.has_value() || bandwidth == 0) {
+    return TCPConfig::INITIAL_CWND_SEGMENTS * mss_;
+  }
+  const double rtt = static_cast<double>(max<uint64_t>(*min_rtt_ms_, 1));
+  return static_cast<uint64_t>(gain * bandwidth * rtt);
+}
+
+namespace {
+
+template <typename Policy>
+class PolicyAdapter final : public CongestionControl {
+  Policy policy_{};
+
+ public:
+  void on_ack(const AckEvent& ack) override { policy_.on_ack(ack); }
+  void on_loss(const LossEvent& loss) override { policy_.on_loss(loss); }
+  void on_rto(const LossEvent& loss) override { policy_.on_rto(loss); }
+  uint64_t cwnd() const override { return policy_.cwnd(); }
+  bool in_recovery() const override { return policy_.in_recovery(); }
+  bool fast_retransmit() const override { return policy_.fast_retransmit(); }
+  optional<double> pacing_rate() const override {
+    return policy_.pacing_rate();
+  }
+};
+
+}  // namespace
+
+unique_ptr<CongestionControl> make_congestion_control(string_view name) {
+  if (name == "none") {
+    return make_unique<PolicyAdapter<NoCongestionControl>>();
+  }
+  if (name == "reno") {
+    return make_unique<PolicyAdapter<Reno>>();
+  }
+  if (name == "newreno") {
+    return make_unique<PolicyAdapter<NewReno>>();
+  }
+  if (name == "cubic") {
+    return make_unique<PolicyAdapter<Cubic>>();
+  }
+  if (name == "bbr") {
+    return make_unique<PolicyAdapter<BBR>>();
+  }
+  throw invalid_argument("unknown congestion control: " + string{name});
+}
@@ -0,0 +1,398 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+#include "tcp_config.hh"
+
+// What a TCPSender tells its congestion controller. Sequence numbers are
+// absolute, and sizes are in sequence numbers.
+struct AckEvent {
+  uint64_t acked;            // newly acknowledged by this ACK
+  uint64_t ackno;            // the ACK itself
+  uint64_t bytes_in_flight;  // outstanding before this ACK
+  uint64_t now_ms;
+  std::optional<uint64_t> rtt_ms;  // RTT sample taken from this ACK, if any
+
+  // Delivery rate sample (draft-cheng-iccrg-delivery-rate-estimation)
+  uint64_t delivered = 0;        // acknowledged so far, this ACK included
+  uint64_t prior_delivered = 0;  // `delivered` when the newest acked segment
+                                 // was sent
+  std::optional<double> delivery_rate{};  // bytes per ms since then, if any
+};
+
+struct LossEvent {
+  uint64_t bytes_in_flight;  // outstanding when the loss was detected
+  uint64_t next_seqno;       // just past the last byte sent so far
+  uint64_t now_ms;
+};
+
+/*
+ * Congestion control policies for BasicTCPSender. Each has
+ *   on_ack(const AckEvent&): new data was acknowledged
+ *   on_loss(const LossEvent&): duplicate ACKs triggered a fast retransmit
+ *   on_rto(const LossEvent&): the retransmission timer expired
+ *   cwnd(): how many sequence numbers may be outstanding
+ *   in_recovery(): whether a partial ACK should retransmit the next segment
+ *   fast_retransmit(): whether duplicate ACKs should trigger on_loss()
+ *   pacing_rate(): bytes per ms to spread sends over, or none to send bursts
+ * and is used as a template parameter, so the sender calls it directly
+ * rather than through a vtable. CongestionControl and AnyCongestionControl
+ * select one at runtime.
+ */
+
+// Sends as much as the receiver's window allows, and never fast-retransmits
+class NoCongestionControl {
+ public:
+  void on_ack(const AckEvent& /* ack */) {}
+  void on_loss(const LossEvent& /* loss */) {}
+  void on_rto(const LossEvent& /* loss */) {}
+  uint64_t cwnd() const { return UINT64_MAX; }
+  bool in_recovery() const { return false; }
+  bool fast_retransmit() const { return false; }
+  std::optional<double> pacing_rate() const { return {}; }
+};
+
+// RFC 5681: slow start, then one segment per RTT of congestion avoidance.
+// Loss halves the window, and recovery ends with the first new ACK.
+class Reno {
+ public:
+  explicit Reno(uint64_t mss = TCPConfig::MAX_PAYLOAD_SIZE)
+      : mss_(mss), cwnd_(TCPConfig::INITIAL_CWND_SEGMENTS * mss) {}
+
+  void on_ack(const AckEvent& ack);
+  void on_loss(const LossEvent& loss);
+  void on_rto(const LossEvent& loss);
+  uint64_t cwnd() const { return cwnd_; }
+  bool in_recovery() const { return recover_.has_value(); }
+  bool fast_retransmit() const { return true; }
+  std::optional<double> pacing_rate() const { return {}; }
+
+  uint64_t ssthresh() const { return ssthresh_; }
+
+ protected:
+  void grow(uint64_t acked);
+  void enter_recovery(const LossEvent& loss, uint64_t ssthresh);
+
+  uint64_t mss_;
+  uint64_t cwnd_;
+  uint64_t ssthresh_ = UINT64_MAX;
+  uint64_t bytes_acked_ = 0;  // toward the next increase in avoidance
+  std::optional<uint64_t> recover_{};  // recovery ends at this ackno
+};
+
+// RFC 6582: as Reno, but recovery lasts until everything outstanding at the
+// loss is acknowledged, with each partial ACK retransmitting the next hole
+class NewReno : public Reno {
+ public:
+  using Reno::Reno;
+
+  void on_ack(const AckEvent& ack);
+};
+
+// RFC 9438: after a loss the window follows a cubic function of the time
+// since, plateauing around the window where the loss happened, and never
+// grows slower than Reno would. Recovery is as NewReno's.
+class Cubic : public NewReno {
+ public:
+  explicit Cubic(uint64_t mss = TCPConfig::MAX_PAYLOAD_SIZE) : NewReno(mss) {}
+
+  void on_ack(const AckEvent& ack);
+  void on_loss(const LossEvent& loss);
+  void on_rto(const LossEvent& loss);
+
+  static constexpr double kC = 0.4;
+  static constexpr double kBeta = 0.7;
+
+ private:
+  void avoid_congestion(const AckEvent& ack);
+  // Remember the window at a loss or timeout, and return the new ssthresh
+  uint64_t reduce();
+
+  double w_max_ = 0;  // window before the last reduction, in segments
+  double w_est_ = 0;  // what Reno would have grown to, in segments
+  double k_ = 0;      // seconds from the epoch start to reach w_max_
+  double partial_bytes_ = 0;  // growth not yet added to cwnd_
+  std::optional<uint64_t> epoch_start_ms_{};
+  uint64_t min_rtt_ms_ = UINT64_MAX;
+};
+
+// The largest sample taken in the last `window` units of time (rounds, for
+// BBR's bandwidth). Candidates are kept in decreasing order, so an update is
+// O(1) amortized and the maximum is always at the front.
+class WindowedMaxFilter {
+ public:
+  explicit WindowedMaxFilter(uint64_t window) : window_(window) {}
+
+  void update(uint64_t time, double sample);
+  double best() const { return samples_.empty() ? 0 : samples_.front().second; }
+
+ private:
+  uint64_t window_;
+  std::deque<std::pair<uint64_t, double>> samples_{};  // (time, sample)
+};
+
+// BBR (draft-cardwell-iccrg-bbr-congestion-control-00): instead of reacting
+// to loss, models the path by its bottleneck bandwidth (the max delivery rate
+// over the last ten rounds) and propagation delay (the min RTT over the last
+// ten seconds). It paces at a gain times that bandwidth and keeps about two
+// bandwidth-delay products in flight, so a deep buffer stays nearly empty.
+//
+// startup: doubles the rate each round until bandwidth stops growing
+// drain: paces below the bandwidth until the queue startup built is gone
+// probe_bw: cycles the pacing gain through 1.25, 0.75 and six rounds of 1
+// probe_rtt: every ten seconds without a new min RTT, drops to four segments
+//            in flight for 200 ms so the min RTT can be measured again
+class BBR {
+ public:
+  enum class State { startup, drain, probe_bw, probe_rtt };
+
+  explicit BBR(uint64_t mss = TCPConfig::MAX_PAYLOAD_SIZE)
+      : mss_(mss), cwnd_(TCPConfig::INITIAL_CWND_SEGMENTS * mss) {}
+
+  void on_ack(const AckEvent& ack);
+  void on_loss(const LossEvent& loss);
+  void on_rto(const LossEvent& loss);
+  uint64_t cwnd() const { return cwnd_; }
+  bool in_recovery() const { return recover_.has_value(); }
+  bool fast_retransmit() const { return true; }
+  std::optional<double> pacing_rate() const { return pacing_rate_; }
+
+  State state() const { return state_; }
+  double bottleneck_bandwidth() const { return bandwidth_.best(); }
+  std::optional<uint64_t> min_rtt_ms() const { return min_rtt_ms_; }
+
+  static constexpr double kHighGain = 2.885;  // 2/ln 2: doubles every round
+  static constexpr double kCwndGain = 2;
+  static constexpr uint64_t kBandwidthWindowRounds = 10;
+  static constexpr uint64_t kMinRttWindowMs = 10'000;
+  static constexpr uint64_t kProbeRttMs = 200;
+  static constexpr uint64_t kMinCwndSegments = 4;
+
+ private:
+  void update_model(const AckEvent& ack, bool min_rtt_expired);
+  void check_full_pipe();
+  void update_cycle_phase(const AckEvent& ack, uint64_t in_flight);
+  void enter_probe_bw(uint64_t now_ms);
+  void handle_probe_rtt(const AckEvent& ack, uint64_t in_flight);
+  void set_cwnd(const AckEvent& ack);
+  // `gain` bandwidth-delay products, or the initial window with no model yet
+  uint64_t bdp(double gain) const;
+
+  uint64_t mss_;
+  uint64_t cwnd_;
+  uint64_t prior_cwnd_ = 0;  // restored after probe_rtt
+  std::optional<uint64_t> recover_{};
+  std::optional<double> pacing_rate_{};
+
+  State state_ = State::startup;
+  double pacing_gain_ = kHighGain;
+  double cwnd_gain_ = kHighGain;
+
+  // A round ends when a segment sent after it began is acknowledged
+  uint64_t round_count_ = 0;
+  uint64_t next_round_delivered_ = 0;
+  bool round_start_ = false;
+
+  WindowedMaxFilter bandwidth_{kBandwidthWindowRounds};  // bytes per ms
+  std::optional<uint64_t> min_rtt_ms_{};
+  uint64_t min_rtt_stamp_ms_ = 0;
+
+  // Startup ends once three rounds pass without 25% more bandwidth
+  bool filled_pipe_ = false;
+  double full_bandwidth_ = 0;
+  uint64_t full_bandwidth_rounds_ = 0;
+
+  size_t cycle_index_ = 0;
+  uint64_t cycle_stamp_ms_ = 0;
+  std::optional<uint64_t> probe_rtt_done_ms_{};
+  bool probe_rtt_round_done_ = false;
+};
+
+// The hooks BasicTCPSender calls on every ACK, loss and timeout are defined
+// here, so that a sender with a concrete policy can inline them
+
+inline void Reno::on_ack(const AckEvent& ack) {
+  if (recover_.has_value()) {
+    recover_.reset();
+    cwnd_ = ssthresh_;
+    return;
+  }
+  grow(ack.acked);
+}
+
+inline void Reno::on_loss(const LossEvent& loss) {
+  enter_recovery(loss, std::max(loss.bytes_in_flight / 2, 2 * mss_));
+}
+
+inline void Reno::on_rto(const LossEvent& loss) {
+  // Back to slow start from one segment
+  ssthresh_ = std::max(loss.bytes_in_flight / 2, 2 * mss_);
+  cwnd_ = mss_;
+  bytes_acked_ = 0;
+  recover_.reset();
+}
+
+inline void Reno::grow(uint64_t acked) {
+  if (cwnd_ < ssthresh_) {
+    cwnd_ += std::min(acked, mss_);
+    return;
+  }
+  // Appropriate byte counting (RFC 3465): one segment per window acked
+  bytes_acked_ += acked;
+  if (bytes_acked_ >= cwnd_) {
+    bytes_acked_ -= cwnd_;
+    cwnd_ += mss_;
+  }
+}
+
+inline void Reno::enter_recovery(const LossEvent& loss, uint64_t ssthresh) {
+  ssthresh_ = ssthresh;
+  cwnd_ = ssthresh;
+  bytes_acked_ = 0;
+  recover_ = loss.next_seqno;
+}
+
+inline void NewReno::on_ack(const AckEvent& ack) {
+  if (recover_.has_value()) {
+    // A partial ACK keeps recovery going, and the sender retransmits the
+    // next segment; a full one ends it
+    if (ack.ackno >= *recover_) {
+      recover_.reset();
+      cwnd_ = ssthresh_;
+    }
+    return;
+  }
+  grow(ack.acked);
+}
+
+inline void Cubic::on_ack(const AckEvent& ack) {
+  if (ack.rtt_ms.has_value()) {
+    min_rtt_ms_ = std::min(min_rtt_ms_, *ack.rtt_ms);
+  }
+  if (in_recovery()) {
+    NewReno::on_ack(ack);
+    return;
+  }
+  if (cwnd_ < ssthresh_) {
+    cwnd_ += std::min(ack.acked, mss_);
+    return;
+  }
+  avoid_congestion(ack);
+}
+
+inline void Cubic::on_loss(const LossEvent& loss) {
+  enter_recovery(loss, reduce());
+}
+
+inline void Cubic::on_rto(const LossEvent& loss) {
+  const uint64_t ssthresh = reduce();
+  Reno::on_rto(loss);
+  ssthresh_ = ssthresh;
+}
+
+inline void BBR::on_ack(const AckEvent& ack) {
+  const uint64_t in_flight =
+      ack.bytes_in_flight - std::min(ack.acked, ack.bytes_in_flight);
+  if (recover_.has_value() && ack.ackno >= *recover_) {
+    recover_.reset();
+  }
+
+  const bool min_rtt_expired = min_rtt_ms_.has_value() &&
+                               ack.now_ms > min_rtt_stamp_ms_ + kMinRttWindowMs;
+  update_model(ack, min_rtt_expired);
+
+  if (state_ == State::probe_bw) {
+    update_cycle_phase(ack, in_flight);
+  }
+  if (!filled_pipe_ && round_start_) {
+    check_full_pipe();
+  }
+  if (state_ == State::startup && filled_pipe_) {
+    state_ = State::drain;
+    pacing_gain_ = 1 / kHighGain;
+    cwnd_gain_ = kHighGain;
+  }
+  if (state_ == State::drain && in_flight <= bdp(1)) {
+    enter_probe_bw(ack.now_ms);
+  }
+  if (state_ != State::probe_rtt && min_rtt_expired) {
+    state_ = State::probe_rtt;
+    pacing_gain_ = 1;
+    cwnd_gain_ = 1;
+    prior_cwnd_ = cwnd_;
+    probe_rtt_done_ms_.reset();
+  }
+  if (state_ == State::probe_rtt) {
+    handle_probe_rtt(ack, in_flight);
+  }
+
+  // Until the model has a bandwidth worth pacing at, assume the initial
+  // window per RTT. Startup may only raise the rate; afterwards it follows
+  // the model.
+  if (!pacing_rate_.has_value() && min_rtt_ms_.has_value()) {
+    pacing_rate_ = pacing_gain_ * static_cast<double>(cwnd_) /
+                   static_cast<double>(std::max<uint64_t>(*min_rtt_ms_, 1));
+  }
+  const double bandwidth = bandwidth_.best();
+  if (bandwidth > 0) {
+    const double rate = pacing_gain_ * bandwidth;
+    if (filled_pipe_ || !pacing_rate_.has_value() || rate > *pacing_rate_) {
+      pacing_rate_ = rate;
+    }
+  }
+  set_cwnd(ack);
+}
+
+inline void BBR::on_loss(const LossEvent& loss) {
+  // Loss is not a congestion signal to the model; recovery just repairs it
+  recover_ = loss.next_seqno;
+}
+
+inline void BBR::on_rto(const LossEvent& /* loss */) {
+  // Everything in flight is presumed lost: restart from one segment, and
+  // let ACKs grow the window back toward the model's target
+  prior_cwnd_ = std::max(prior_cwnd_, cwnd_);
+  cwnd_ = mss_;
+  recover_.reset();
+}
+
+// The runtime interface, for choosing a policy by name
+class CongestionControl {
+ public:
+  virtual ~CongestionControl() = default;
+  virtual void on_ack(const AckEvent& ack) = 0;
+  virtual void on_loss(const LossEvent& loss) = 0;
+  virtual void on_rto(const LossEvent& loss) = 0;
+  virtual uint64_t cwnd() const = 0;
+  virtual bool in_recovery() const = 0;
+  virtual bool fast_retransmit() const = 0;
+  virtual std::optional<double> pacing_rate() const = 0;
+};
+
+// "none", "reno", "newreno", "cubic" or "bbr"; throws std::invalid_argument for
+// anything else
+std::unique_ptr<CongestionControl> make_congestion_control(
+    std::string_view name);
+
+// A policy that forwards to a CongestionControl chosen at runtime
+class AnyCongestionControl {
+  std::unique_ptr<CongestionControl> impl_;
+
+ public:
+  explicit AnyCongestionControl(std::string_view name = "none")
+      : impl_(make_congestion_control(name)) {}
+
+  void on_ack(const AckEvent& ack) { impl_->on_ack(ack); }
+  void on_loss(const LossEvent& loss) { impl_->on_loss(loss); }
+  void on_rto(const LossEvent& loss) { impl_->on_rto(loss); }
+  uint64_t cwnd() const { return impl_->cwnd(); }
+  bool in_recovery() const { return impl_->in_recovery(); }
+  bool fast_retransmit() const { return impl_->fast_retransmit(); }
+  std::optional<double> pacing_rate() const { return impl_->pacing_rate(); }
+};
@@ -1,15 +1,51 @@
 #include "reassembler.hh"
 
+#include <algorithm>
+#include <bit>
 #include <cassert>
+#include <cstring>
+#include <iterator>
 #include <set>
+#include <utility>
+#include <vector>
 
 using namespace std;
 
+Reassembler::Reassembler(Engine engine)
+    : Reassembler(engine, Limits{UINT64_MAX, UINT64_MAX}) {}
+
+Reassembler::Reassembler(Engine engine, Limits limits)
+    : engine_(engine), limits_(limits) {}
+
 void Reassembler::insert(uint64_t first_index, string data,
                          bool is_last_substring, Writer &output) {
   if (is_last_substring) {
     last_index_ = first_index + data.size();
   }
+  if (is_next(first_index)) {
+    ++fast_path_hits_;
+    data.resize(min(static_cast<uint64_t>(data.size()),
+                    last_index_ - first_index_));
+    const uint64_t pushed_before = output.bytes_pushed();
+    output.push(std::move(data));
+    advance(output.bytes_pushed() - pushed_before, output);
+    return;
+  }
+  ++slow_path_hits_;
+
+  if (engine_ == Engine::byte_ring) {
+    ring_store(first_index, data, output.available_capacity());
+    ring_flush(output);
+    return;
+  }
+  if (engine_ == Engine::interval_set) {
+    const uint64_t length = data.size();
+    interval_store(first_index, Buffer{std::move(data)}, 0, length,
+                   output.available_capacity());
+    interval_flush(output);
+    enforce_limits();
+    return;
+  }
   auto pair = string_splitter(first_index, data, output.available_capacity());
   first_index = pair.first;
   std::string cut_data = pair.second;
@@ -33,6 +69,181 @@ void Reassembler::insert(uint64_t first_index, string data,
   } while (false);
 
   checkout_write(output);
+  enforce_limits();
+}
+
+void Reassembler::insert(uint64_t first_index, const Buffer &payload,
+                         uint64_t offset, uint64_t length,
+                         bool is_last_substring, Writer &output) {
+  const string_view data = string_view{payload}.substr(offset, length);
+  if (engine_ == Engine::segment_map) {
+    insert(first_index, string{data}, is_last_substring, output);
+    return;
+  }
+
+  if (is_last_substring) {
+    last_index_ = first_index + data.size();
+  }
+  if (is_next(first_index)) {
+    ++fast_path_hits_;
+    push_next(payload, offset, data.size(), output);
+    return;
+  }
+  ++slow_path_hits_;
+
+  if (engine_ == Engine::byte_ring) {
+    ring_store(first_index, data, output.available_capacity());
+    ring_flush(output);
+    return;
+  }
+  interval_store(first_index, payload, offset, data.size(),
+                 output.available_capacity());
+  interval_flush(output);
+  enforce_limits();
+}
+
+void Reassembler::insert_batch(span<const Substring> batch, Writer &output) {
+  for (const Substring &substring : batch) {
+    if (substring.is_last_substring) {
+      last_index_ = substring.first_index + substring.length;
+    }
+  }
+
+  vector<const Substring *> sorted;
+  sorted.reserve(batch.size());
+  for (const Substring &substring : batch) {
+    sorted.push_back(&substring);
+  }
+  stable_sort(sorted.begin(), sorted.end(),
+              [](const Substring *a, const Substring *b) {
+                return a->first_index < b->first_index;
+              });
+
+  if (engine_ == Engine::segment_map) {
+    for (const Substring *substring : sorted) {
+      insert(substring->first_index,
+             string{string_view{substring->payload}.substr(substring->offset,
+                                                           substring->length)},
+             substring->is_last_substring, output);
+    }
+    return;
+  }
+
+  // The window is fixed until the flush, since nothing below is written
+  // until then (except the leading in-order run, which moves it first)
+  bool stored = false;
+  for (const Substring *substring : sorted) {
+    if (not stored and is_next(substring->first_index)) {
+      ++fast_path_hits_;
+      push_next(substring->payload, substring->offset, substring->length,
+                output);
+      continue;
+    }
+    ++slow_path_hits_;
+    stored = true;
+
+    if (engine_ == Engine::byte_ring) {
+      ring_store(substring->first_index,
+                 string_view{substring->payload}.substr(substring->offset,
+                                                        substring->length),
+                 output.available_capacity());
+    } else {
+      interval_store(substring->first_index, substring->payload,
+                     substring->offset, substring->length,
+                     output.available_capacity());
+    }
+  }
+
+  if (engine_ == Engine::byte_ring) {
+    ring_flush(output);
+  } else {
+    interval_flush(output);
+    enforce_limits();
+  }
+}
+
+void Reassembler::enforce_limits() {
+  // What one stored piece costs beyond its payload bytes (a red-black tree
+  // node is the key/value pair plus a color and three pointers)
+  const uint64_t overhead =
+      engine_ == Engine::segment_map
+          ? sizeof(decltype(segments_map_)::value_type) + 4 * sizeof(void *)
+          : sizeof(Interval);
+  const uint64_t max_pieces =
+      min(limits_.max_intervals, limits_.max_overhead_bytes / overhead);
+
+  if (engine_ == Engine::segment_map) {
+    while (segments_map_.size() > max_pieces) {
+      const auto last = prev(segments_map_.end());
+      ++evicted_intervals_;
+      evicted_bytes_ += last->second.size();
+      bytes_pending_ -= last->second.size();
+      segments_map_.erase(last);
+    }
+  } else if (engine_ == Engine::interval_set) {
+    if (intervals_.size() > max_pieces) {
+      coalesce_intervals();
+    }
+    while (intervals_.size() > max_pieces) {
+      ++evicted_intervals_;
+      evicted_bytes_ += intervals_.back().length;
+      bytes_pending_ -= intervals_.back().length;
+      intervals_.pop_back();
+    }
+  }
+}
+
+void Reassembler::coalesce_intervals() {
+  // Copy each run of touching intervals into one payload of its own
+  vector<Interval> coalesced;
+  for (auto run = intervals_.begin(); run != intervals_.end();) {
+    auto run_end = next(run);
+    while (run_end != intervals_.end() and
+           prev(run_end)->end() == run_end->first_index) {
+      ++run_end;
+    }
+
+    if (run_end == next(run)) {
+      coalesced.push_back(std::move(*run));
+    } else {
+      string bytes;
+      bytes.reserve(prev(run_end)->end() - run->first_index);
+      for (auto it = run; it != run_end; ++it) {
+        bytes += string_view{it->payload}.substr(it->offset, it->length);
+      }
+      const uint64_t length = bytes.size();
+      coalesced.push_back(
+          Interval{run->first_index, length, Buffer{std::move(bytes)}, 0});
+    }
+    run = run_end;
+  }
+  intervals_ = std::move(coalesced);
+}
+
+uint64_t Reassembler::insert_next(const Buffer &payload, Writer &output) {
+  assert(bytes_pending_ == 0);
+  ++fast_path_hits_;
+  const uint64_t first_index = first_index_;
+  push_next(payload, 0, payload.size(), output);
+  return first_index_ - first_index;
+}
+
+bool Reassembler::is_next(uint64_t first_index) const {
+  return first_index == first_index_ and bytes_pending_ == 0;
+}
+
+void Reassembler::push_next(const Buffer &payload, uint64_t offset,
+                            uint64_t length, Writer &output) {
+  const uint64_t pushed_before = output.bytes_pushed();
+  output.push(payload, offset, min(length, last_index_ - first_index_));
+  advance(output.bytes_pushed() - pushed_before, output);
+}
+
+void Reassembler::advance(uint64_t len, Writer &output) {
+  first_index_ += len;
+  if (first_index_ == last_index_) {
+    output.close();
+  }
 }
 
 std::pair<uint64_t, std::string> Reassembler::string_splitter(
@@ -165,3 +376,302 @@ void Reassembler::checkout_write(Writer &output) {
 }
 
 uint64_t Reassembler::bytes_pending() const { return bytes_pending_; }
+
+uint64_t Reassembler::fast_path_hits() const { return fast_path_hits_; }
+
+uint64_t Reassembler::slow_path_hits() const { return slow_path_hits_; }
+
+uint64_t Reassembler::evicted_intervals() const { return evicted_intervals_; }
+
+uint64_t Reassembler::evicted_bytes() const { return evicted_bytes_; }
+
+uint64_t Reassembler::bytes_retained() const {
+  if (engine_ == Engine::byte_ring) {
+    return ring_.size();
+  }
+  if (engine_ == Engine::segment_map) {
+    return bytes_pending_;
+  }
+  // Slices of one payload share it, so it counts once
+  set<const char *> payloads;
+  uint64_t retained = 0;
+  for (const Interval &interval : intervals_) {
+    if (payloads.insert(string_view{interval.payload}.data()).second) {
+      retained += interval.payload.size();
+    }
+  }
+  return retained;
+}
+
+vector<pair<uint64_t, uint64_t>> Reassembler::held_intervals() const {
+  if (engine_ == Engine::byte_ring) {
+    return ring_held_intervals();
+  }
+
+  // Stored pieces may touch without having been merged; report each run once
+  vector<pair<uint64_t, uint64_t>> held;
+  const auto add = [&](uint64_t first, uint64_t end) {
+    if (not held.empty() and held.back().second == first) {
+      held.back().second = end;
+    } else {
+      held.emplace_back(first, end);
+    }
+  };
+  if (engine_ == Engine::segment_map) {
+    for (const auto &[index, segment] : segments_map_) {
+      add(index, index + segment.size());
+    }
+  } else {
+    for (const Interval &interval : intervals_) {
+      add(interval.first_index, interval.end());
+    }
+  }
+  return held;
+}
+
+void Reassembler::ring_store(uint64_t first_index, string_view data,
+                             uint64_t available_capacity) {
+  // Keep only the bytes inside the window, and none past the end of stream
+  const uint64_t window_len =
+      min(available_capacity, last_index_ - first_index_);
+  const uint64_t begin = max(first_index, first_index_);
+  const uint64_t end =
+      min(first_index + data.size(), first_index_ + window_len);
+
+  if (begin < end) {
+    ring_reserve(window_len);
+    data = data.substr(begin - first_index, end - begin);
+
+    // One copy into the ring, in at most two pieces
+    const uint64_t pos = begin & (ring_.size() - 1);
+    const uint64_t first_len = min(data.size(), ring_.size() - pos);
+    memcpy(ring_.data() + pos, data.data(), first_len);
+    memcpy(ring_.data(), data.data() + first_len, data.size() - first_len);
+
+    bytes_pending_ += ring_set_present(begin, data.size(), true);
+  }
+}
+
+void Reassembler::ring_reserve(uint64_t len) {
+  if (len <= ring_.size()) {
+    return;
+  }
+
+  const uint64_t new_size = bit_ceil(len);
+  string old_ring = std::exchange(ring_, string(new_size, 0));
+  vector<uint64_t> old_present =
+      std::exchange(present_, vector<uint64_t>((new_size + 63) / 64));
+
+  // Re-home the bytes already held (rare: only when the window grows)
+  const uint64_t old_mask = old_ring.size() - 1;
+  for (uint64_t index = first_index_; index < first_index_ + old_ring.size();
+       ++index) {
+    const uint64_t pos = index & old_mask;
+    if ((old_present[pos / 64] >> (pos % 64)) & 1) {
+      ring_[index & (new_size - 1)] = old_ring[pos];
+      ring_set_present(index, 1, true);
+    }
+  }
+}
+
+uint64_t Reassembler::ring_set_present(uint64_t first_index, uint64_t len,
+                                       bool present) {
+  const uint64_t mask = ring_.size() - 1;
+  uint64_t changed = 0;
+  for (uint64_t index = first_index; index < first_index + len;) {
+    const uint64_t pos = index & mask;
+    const uint64_t bit = pos % 64;
+    const uint64_t n =
+        min({first_index + len - index, 64 - bit, ring_.size() - pos});
+    const uint64_t bits = (n == 64 ? ~uint64_t{0} : (uint64_t{1} << n) - 1)
+                          << bit;
+
+    uint64_t &word = present_[pos / 64];
+    changed += popcount(present ? bits & ~word : bits & word);
+    word = present ? word | bits : word & ~bits;
+    index += n;
+  }
+  return changed;
+}
+
+uint64_t Reassembler::ring_contiguous() const {
+  // Scan a word at a time for the run of present bytes at first_index_
+  const uint64_t mask = ring_.size() - 1;
+  uint64_t len = 0;
+  while (len < ring_.size()) {
+    const uint64_t pos = (first_index_ + len) & mask;
+    const uint64_t bit = pos % 64;
+    const uint64_t limit =
+        min({64 - bit, ring_.size() - pos, ring_.size() - len});
+    const uint64_t run =
+        min(static_cast<uint64_t>(countr_one(present_[pos / 64] >> bit)),
+            limit);
+    len += run;
+    if (run < limit) {
+      break;
+    }
+  }
+  return len;
+}
+
+vector<pair<uint64_t, uint64_t>> Reassembler::ring_held_intervals() const {
+  // Alternate between scanning for the next present and the next missing
+  // byte, a word at a time, across the window
+  vector<pair<uint64_t, uint64_t>> held;
+  const uint64_t mask = ring_.size() - 1;
+  const uint64_t end = first_index_ + ring_.size();
+  bool present = false;
+  uint64_t run_start = 0;
+  for (uint64_t index = first_index_; index < end;) {
+    const uint64_t pos = index & mask;
+    const uint64_t bit = pos % 64;
+    const uint64_t limit = min({64 - bit, ring_.size() - pos, end - index});
+    const uint64_t word = present_[pos / 64] >> bit;
+    const uint64_t run = min(
+        static_cast<uint64_t>(present ? countr_one(word) : countr_zero(word)),
+        limit);
+    index += run;
+    if (run < limit) {
+      if (present) {
+        held.emplace_back(run_start, index);
+      }
+      run_start = index;
+      present = not present;
+    }
+  }
+  if (present) {
+    held.emplace_back(run_start, end);
+  }
+  return held;
+}
+
+void Reassembler::ring_flush(Writer &output) {
+  // Bytes held past the stream's free space (if its capacity shrank since
+  // they arrived) stay in the ring until it has room
+  const uint64_t len =
+      ring_.empty() ? 0 : min(ring_contiguous(), output.available_capacity());
+  if (len != 0) {
+    // Copy straight from the ring into the stream's free space
+    const uint64_t mask = ring_.size() - 1;
+    uint64_t index = first_index_;
+    for (const auto dest : output.writable_spans(len)) {
+      for (uint64_t filled = 0; filled < dest.size();) {
+        const uint64_t pos = index & mask;
+        const uint64_t n = min(dest.size() - filled, ring_.size() - pos);
+        memcpy(dest.data() + filled, ring_.data() + pos, n);
+        filled += n;
+        index += n;
+      }
+    }
+    output.commit(len);
+
+    ring_set_present(first_index_, len, false);
+    first_index_ += len;
+    bytes_pending_ -= len;
+  }
+
+  if (first_index_ == last_index_) {
+    output.close();
+  }
+}
+
+void Reassembler::interval_store(uint64_t first_index, Buffer payload,
+                                 uint64_t offset, uint64_t length,
+                                 uint64_t available_capacity) {
+  // Keep only the bytes inside the window, and none past the end of stream
+  const uint64_t window_len =
+      min(available_capacity, last_index_ - first_index_);
+  const uint64_t begin = max(first_index, first_index_);
+  const uint64_t end =
+      min(first_index + length, first_index_ + window_len);
+
+  if (begin < end) {
+    // The intervals overlapping [begin, end): `lo` is the first that ends
+    // after `begin`, `hi` the first that starts at or after `end`
+    const auto lo = partition_point(
+        intervals_.begin(), intervals_.end(),
+        [&](const Interval &interval) { return interval.end() <= begin; });
+    const auto hi = partition_point(
+        lo, intervals_.end(),
+        [&](const Interval &interval) { return interval.first_index < end; });
+
+    // Bytes already held stay where they are, so a duplicate changes
+    // nothing. Only the gaps the new bytes fill are added, each as a slice
+    // of the new payload.
+    vector<Interval> gaps;
+    const auto add_gap = [&](uint64_t gap_begin, uint64_t gap_end) {
+      gaps.push_back(Interval{gap_begin, gap_end - gap_begin, payload,
+                              offset + (gap_begin - first_index)});
+      bytes_pending_ += gap_end - gap_begin;
+    };
+    uint64_t covered = begin;
+    for (auto it = lo; it != hi; ++it) {
+      if (it->first_index > covered) {
+        add_gap(covered, it->first_index);
+      }
+      covered = max(covered, it->end());
+    }
+    if (covered < end) {
+      add_gap(covered, end);
+    }
+    if (gaps.empty()) {
+      return;
+    }
+
+    // Slices adding up to less than half the payload get copies instead: a
+    // peer mostly resending held bytes mustn't pin a whole segment for each
+    // byte it fills in
+    uint64_t gap_bytes = 0;
+    for (const Interval &gap : gaps) {
+      gap_bytes += gap.length;
+    }
+    if (2 * gap_bytes < payload.size()) {
+      for (Interval &gap : gaps) {
+        gap.payload =
+            Buffer{string{string_view{payload}.substr(gap.offset, gap.length)}};
+        gap.offset = 0;
+      }
+    }
+
+    // Interleave the gaps with the run they fall in, in one pass
+    const auto lo_pos = lo - intervals_.begin();
+    const auto overlapped = hi - lo;
+    vector<Interval> merged;
+    merged.reserve(overlapped + gaps.size());
+    std::merge(make_move_iterator(lo), make_move_iterator(hi),
+               make_move_iterator(gaps.begin()),
+               make_move_iterator(gaps.end()), back_inserter(merged),
+               [](const Interval &a, const Interval &b) {
+                 return a.first_index < b.first_index;
+               });
+    move(merged.begin(), merged.begin() + overlapped, lo);
+    intervals_.insert(intervals_.begin() + lo_pos + overlapped,
+                      make_move_iterator(merged.begin() + overlapped),
+                      make_move_iterator(merged.end()));
+  }
+}
+
+void Reassembler::interval_flush(Writer &output) {
+  auto it = intervals_.begin();
+  for (; it != intervals_.end() and it->first_index == first_index_; ++it) {
+    // The stream copies these bytes once, or not at all if it can take a
+    // reference to the payload
+    const uint64_t pushed_before = output.bytes_pushed();
+    output.push(it->payload, it->offset, it->length);
+    const uint64_t copied = output.bytes_pushed() - pushed_before;
+
+    first_index_ += copied;
+    bytes_pending_ -= copied;
+    if (copied < it->length) {
+      it->first_index += copied;
+      it->offset += copied;
+      it->length -= copied;
+      break;
+    }
+  }
+  intervals_.erase(intervals_.begin(), it);
+
+  if (first_index_ == last_index_) {
+    output.close();
+  }
+}
@@ -1,12 +1,48 @@
 #pragma once
 
+#include <cstdint>
 #include <map>
+#include <span>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
+#include "buffer.hh"
 #include "byte_stream.hh"
 
 class Reassembler {
  public:
+  // How the Reassembler stores bytes it can't write yet
+  enum class Engine {
+    segment_map,   // a map from index to substring, merged on overlap
+    byte_ring,     // a window-sized byte ring plus a bitmap of present bytes
+    interval_set,  // sorted, non-overlapping slices of the inserted payloads
+  };
+
+  // Bounds on how fragmented the stored bytes may get, so that a peer sending
+  // tiny segments with gaps between them can't blow up memory or the cost of
+  // each insert. When a bound is exceeded, the pieces furthest from the next
+  // needed byte are evicted. (The byte_ring engine's memory is fixed by the
+  // window, so it ignores these.)
+  struct Limits {
+    uint64_t max_intervals;       // stored out-of-order pieces
+    uint64_t max_overhead_bytes;  // bookkeeping memory spent on those pieces
+  };
+
+  // Bytes [offset, offset + length) of a shared payload, to be inserted as
+  // the substring starting at `first_index`
+  struct Substring {
+    uint64_t first_index;
+    Buffer payload;
+    uint64_t offset;
+    uint64_t length;
+    bool is_last_substring;
+  };
+
+  explicit Reassembler(Engine engine = Engine::interval_set);
+  Reassembler(Engine engine, Limits limits);
+
   /*
    * Insert a new substring to be reassembled into a ByteStream.
    *   `first_index`: the index of the first byte of the substring
@@ -32,9 +68,52 @@ class Reassembler {
   void insert(uint64_t first_index, std::string data, bool is_last_substring,
               Writer &output);
 
+  /*
+   * Insert bytes [offset, offset + length) of a shared `payload` (e.g. a
+   * received segment) as the substring starting at `first_index`. The
+   * interval_set engine keeps a reference to the payload rather than a copy,
+   * so the bytes are copied at most once, into the output stream.
+   */
+  void insert(uint64_t first_index, const Buffer &payload, uint64_t offset,
+              uint64_t length, bool is_last_substring, Writer &output);
+
+  /*
+   * Insert a burst of substrings at once, with the same result as inserting
+   * them one at a time. They are sorted by index first, so the in-order ones
+   * go straight to the output, and the rest are stored before the output is
+   * flushed once.
+   */
+  void insert_batch(std::span<const Substring> batch, Writer &output);
+
+  /*
+   * Write `payload` as the substring at the next needed index, for a caller
+   * that already knows that is where it starts, and return how many bytes
+   * were written. Only valid when nothing is pending.
+   */
+  uint64_t insert_next(const Buffer &payload, Writer &output);
+
   // How many bytes are stored in the Reassembler itself?
   uint64_t bytes_pending() const;
 
+  // How many inserts went straight to the output (the substring was the
+  // next one needed and nothing was pending), and how many went through
+  // the engine?
+  uint64_t fast_path_hits() const;
+  uint64_t slow_path_hits() const;
+
+  // How many stored pieces, and how many bytes, were evicted to stay within
+  // the limits?
+  uint64_t evicted_intervals() const;
+  uint64_t evicted_bytes() const;
+
+  // How much memory do the stored bytes keep alive (the payloads they are
+  // sliced from, or the whole ring)?
+  uint64_t bytes_retained() const;
+
+  // The runs of bytes held past the next needed byte, each as [first, end),
+  // in stream order
+  std::vector<std::pair<uint64_t, uint64_t>> held_intervals() const;
+
  private:
   enum segment_relation {
     intersect,
@@ -42,6 +121,16 @@ class Reassembler {
     contain,
   };
 
+  // Evict the pieces furthest from first_index_ until within limits_
+  void enforce_limits();
+  void coalesce_intervals();
+
+  // In-order fast path
+  bool is_next(uint64_t first_index) const;
+  void push_next(const Buffer &payload, uint64_t offset, uint64_t length,
+                 Writer &output);
+  void advance(uint64_t len, Writer &output);
+
   std::pair<uint64_t, std::string> string_splitter(uint64_t first_index,
                                                    const std::string &data,
                                                    uint64_t available_capacity);
@@ -52,8 +141,50 @@ class Reassembler {
   std::string merge_segment(uint64_t left_index, uint64_t right_index);
   void checkout_write(Writer &output);
 
+  // Engine::byte_ring
+  void ring_store(uint64_t first_index, std::string_view data,
+                  uint64_t available_capacity);
+  void ring_reserve(uint64_t len);
+  uint64_t ring_set_present(uint64_t first_index, uint64_t len, bool present);
+  uint64_t ring_contiguous() const;
+  std::vector<std::pair<uint64_t, uint64_t>> ring_held_intervals() const;
+  void ring_flush(Writer &output);
+
+  // Engine::interval_set
+  void interval_store(uint64_t first_index, Buffer payload, uint64_t offset,
+                      uint64_t length, uint64_t available_capacity);
+  void interval_flush(Writer &output);
+
+  // Bytes [first_index, first_index + length) of the stream, which sit at
+  // `offset` within a payload shared with the substring they arrived in
+  struct Interval {
+    uint64_t first_index;
+    uint64_t length;
+    Buffer payload;
+    uint64_t offset;
+
+    uint64_t end() const { return first_index + length; }
+  };
+
+  Engine engine_;
+  Limits limits_;
+
   std::map<uint64_t, std::string> segments_map_;
+
+  // Byte `i` of the stream lives at `ring_[i & (ring_.size() - 1)]`, and bit
+  // `i & (ring_.size() - 1)` of `present_` says whether it has arrived. Only
+  // the window starting at `first_index_` is ever held.
+  std::string ring_{};
+  std::vector<uint64_t> present_{};
+
+  // Sorted by first_index, and never overlapping
+  std::vector<Interval> intervals_{};
+
   uint64_t first_index_ = 0;
   uint64_t bytes_pending_ = 0;
   uint64_t last_index_ = UINT64_MAX;
+  uint64_t fast_path_hits_ = 0;
+  uint64_t slow_path_hits_ = 0;
+  uint64_t evicted_intervals_ = 0;
+  uint64_t evicted_bytes_ = 0;
 };
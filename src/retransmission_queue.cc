@@ -0,0 +1,52 @@
+#include "retransmission_queue.hh"
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+using namespace std;
+
+void RetransmissionQueue::push_back(Segment segment) {
+  assert(empty() or (*this)[size_ - 1].end() == segment.seqno);
+  if (size_ == ring_.size()) {
+    grow();
+  }
+  ring_[(head_ + size_) & mask_] = std::move(segment);
+  ++size_;
+}
+
+size_t RetransmissionQueue::count_ending_by(uint64_t seqno,
+                                            size_t limit) const {
+  // Segments are contiguous, so their ends increase from the front
+  size_t low = 0;
+  size_t high = min(limit, size_);
+  while (low < high) {
+    const size_t mid = low + (high - low) / 2;
+    if ((*this)[mid].end() <= seqno) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+void RetransmissionQueue::pop_front(size_t count) {
+  count = min(count, size_);
+  for (size_t i = 0; i < count; ++i) {
+    ring_[(head_ + i) & mask_].reset();
+  }
+  head_ = (head_ + count) & mask_;
+  size_ -= count;
+}
+
+void RetransmissionQueue::grow() {
+  // Double the ring, moving the segments to the front of the new one
+  vector<optional<Segment>> ring(max<size_t>(16, ring_.size() * 2));
+  for (size_t i = 0; i < size_; ++i) {
+    ring[i] = std::move(ring_[(head_ + i) & mask_]);
+  }
+  ring_ = std::move(ring);
+  head_ = 0;
+  mask_ = ring_.size() - 1;
+}
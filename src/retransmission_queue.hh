@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "tcp_sender_message.hh"
+
+// The segments a TCPSender has queued or sent and not yet seen acknowledged,
+// in sequence order, held in one contiguous ring. Appending and trimming
+// acknowledged segments off the front are O(1) amortized, and the segment
+// boundary an ackno falls on is found by binary search.
+class RetransmissionQueue {
+ public:
+  struct Segment {
+    uint64_t seqno;  // absolute sequence number of the segment's first byte
+    TCPSenderMessage message;
+
+    // When the segment was last sent, and the delivery-rate state then: how
+    // much had been acknowledged, when, and when the segment that began the
+    // current sample interval went out
+    uint64_t sent_ms = 0;
+    uint64_t delivered = 0;
+    uint64_t delivered_ms = 0;
+    uint64_t first_sent_ms = 0;
+    bool retransmitted = false;
+
+    uint64_t end() const { return seqno + message.sequence_length(); }
+  };
+
+  bool empty() const { return size_ == 0; }
+  size_t size() const { return size_; }
+
+  // The `i`th segment from the front
+  Segment &operator[](size_t i) { return *ring_[(head_ + i) & mask_]; }
+  const Segment &operator[](size_t i) const {
+    return *ring_[(head_ + i) & mask_];
+  }
+  Segment &front() { return (*this)[0]; }
+  const Segment &front() const { return (*this)[0]; }
+
+  // Append a segment, which must start where the last one ends
+  void push_back(Segment segment);
+
+  // How many of the first `limit` segments end at or before `seqno`
+  size_t count_ending_by(uint64_t seqno, size_t limit) const;
+
+  // Drop the first `count` segments
+  void pop_front(size_t count);
+
+ private:
+  void grow();
+
+  // Slot `(head_ + i) & mask_` holds the `i`th segment. Empty slots hold
+  // nothing, so acknowledged payloads are released right away.
+  std::vector<std::optional<Segment>> ring_{};
+  size_t head_ = 0;
+  size_t size_ = 0;
+  size_t mask_ = 0;
+};
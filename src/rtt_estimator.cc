@@ -0,0 +1,45 @@
+#include "rtt_estimator.hh"
+
+#include <algorithm>
+
+using namespace std;
+
+RTTEstimator::RTTEstimator(uint64_t initial_RTO_ms, Bounds bounds)
+    : bounds_(bounds),
+      rto_ms_(clamp(initial_RTO_ms, bounds.min_RTO_ms, bounds.max_RTO_ms)) {}
+
+void RTTEstimator::sample(uint64_t rtt_ms) {
+  if (!srtt8_.has_value()) {
+    // SRTT = R, RTTVAR = R/2
+    srtt8_ = rtt_ms << 3;
+    rttvar4_ = rtt_ms << 1;
+  } else {
+    // RTTVAR = 3/4 RTTVAR + 1/4 |SRTT - R|, then SRTT = 7/8 SRTT + 1/8 R
+    const uint64_t srtt = *srtt8_ >> 3;
+    const uint64_t deviation = srtt > rtt_ms ? srtt - rtt_ms : rtt_ms - srtt;
+    rttvar4_ = rttvar4_ - (rttvar4_ >> 2) + deviation;
+    *srtt8_ = *srtt8_ - (*srtt8_ >> 3) + rtt_ms;
+  }
+
+  // With a 1 ms clock, the variance term is at least one tick
+  const uint64_t rto = (*srtt8_ >> 3) + max<uint64_t>(rttvar4_, 1);
+  rto_ms_ = clamp(rto, bounds_.min_RTO_ms, bounds_.max_RTO_ms);
+}
+
+void RTTEstimator::back_off() {
+  rto_ms_ = min(rto_ms_ * 2, bounds_.max_RTO_ms);
+}
+
+optional<uint64_t> RTTEstimator::srtt_ms() const {
+  if (!srtt8_.has_value()) {
+    return {};
+  }
+  return *srtt8_ >> 3;
+}
+
+optional<uint64_t> RTTEstimator::rttvar_ms() const {
+  if (!srtt8_.has_value()) {
+    return {};
+  }
+  return rttvar4_ >> 2;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+
+#include "tcp_config.hh"
+
+// The retransmission timeout of RFC 6298: a smoothed RTT and its mean
+// deviation, kept as Jacobson's scaled integers (8 x SRTT and 4 x RTTVAR),
+// give RTO = SRTT + 4 x RTTVAR, doubled on each timeout until the next sample
+class RTTEstimator {
+ public:
+  struct Bounds {
+    uint64_t min_RTO_ms = TCPConfig::MIN_RTO_DFLT;
+    uint64_t max_RTO_ms = TCPConfig::MAX_RTO_DFLT;
+  };
+
+  RTTEstimator(uint64_t initial_RTO_ms, Bounds bounds);
+
+  // Take an RTT measurement, which must not come from a segment that was
+  // retransmitted unless a timestamp says which transmission it timed
+  void sample(uint64_t rtt_ms);
+
+  // The retransmission timer expired: double the RTO, up to the maximum
+  void back_off();
+
+  uint64_t rto_ms() const { return rto_ms_; }
+  std::optional<uint64_t> srtt_ms() const;
+  std::optional<uint64_t> rttvar_ms() const;
+
+ private:
+  Bounds bounds_;
+  uint64_t rto_ms_;
+  std::optional<uint64_t> srtt8_{};  // none before the first sample
+  uint64_t rttvar4_ = 0;
+};
@@ -1,33 +1,394 @@
 #include "tcp_receiver.hh"
 
+#include <algorithm>
 #include <cmath>
 
 using namespace std;
 
-void TCPReceiver::receive(TCPSenderMessage message, Reassembler& reassembler,
-                          Writer& inbound_stream) {
+void TCPReceiver::receive(const TCPSenderMessage& message,
+                          Reassembler& reassembler, Writer& inbound_stream) {
+  if (receive_predicted(message, reassembler, inbound_stream)) {
+    ++predicted_hits_;
+    return;
+  }
+  ++predicted_misses_;
+
   if (message.SYN) {
     zero_point_ = message.seqno;
     checkpoint_ += 1;
-  } else if (!zero_point_.has_value()) {
+    window_scale_ = scale_for(message, inbound_stream);
+    ts_recent_ = message.tsval;
+    sack_permitted_ = message.sack_permitted;
+  } else if (!zero_point_.has_value() || fails_paws(message)) {
     return;
+  } else {
+    update_ts_recent(message);
+    if (is_stale(message)) {
+      owe_ack(message, false);
+      return;
+    }
   }
   uint64_t bytes_pushed_before = inbound_stream.bytes_pushed();
+  const uint64_t pending_before = reassembler.bytes_pending();
   uint64_t insert_index =
       message.seqno.unwrap(zero_point_.value(), checkpoint_);
-  reassembler.insert(insert_index - (message.SYN ? 0 : 1),
-                     message.payload.release(), message.FIN, inbound_stream);
+  reassembler.insert(insert_index - (message.SYN ? 0 : 1), message.payload, 0,
+                     message.payload.size(), message.FIN, inbound_stream);
   uint64_t bytes_pushed_after = inbound_stream.bytes_pushed();
   checkpoint_ +=
       bytes_pushed_after - bytes_pushed_before + inbound_stream.is_closed();
+  owe_ack(message, insert_index - (message.SYN ? 0 : 1) ==
+                           bytes_pushed_before and
+                       pending_before == 0 and
+                       reassembler.bytes_pending() == 0);
+  if (!message.payload.empty()) {
+    const uint64_t arrived =
+        max(insert_index - (message.SYN ? 0 : 1), bytes_pushed_after);
+    update_sack_blocks({&arrived, 1}, reassembler);
+  }
+  adjust_receive_buffer(inbound_stream);
+}
+
+void TCPReceiver::receive_batch(span<const TCPSenderMessage> messages,
+                                Reassembler& reassembler,
+                                Writer& inbound_stream) {
+  vector<Reassembler::Substring> batch;
+  batch.reserve(messages.size());
+  // Where the next in-order payload would start, once the batch is written
+  uint64_t next_index = inbound_stream.bytes_pushed();
+  bool in_order = reassembler.bytes_pending() == 0;
+  for (const TCPSenderMessage& message : messages) {
+    if (message.SYN) {
+      // Everything before a SYN was sent relative to the old zero point
+      insert_substrings(batch, reassembler, inbound_stream);
+      batch.clear();
+      zero_point_ = message.seqno;
+      checkpoint_ += 1;
+      window_scale_ = scale_for(message, inbound_stream);
+      ts_recent_ = message.tsval;
+      sack_permitted_ = message.sack_permitted;
+      next_index = inbound_stream.bytes_pushed();
+    } else if (!zero_point_.has_value() || fails_paws(message)) {
+      continue;
+    } else {
+      update_ts_recent(message);
+      if (is_stale(message)) {
+        owe_ack(message, false);
+        continue;
+      }
+    }
+    uint64_t insert_index =
+        message.seqno.unwrap(zero_point_.value(), checkpoint_);
+    batch.push_back(Reassembler::Substring{
+        insert_index - (message.SYN ? 0 : 1), message.payload, 0,
+        message.payload.size(), message.FIN});
+
+    in_order = in_order and batch.back().first_index == next_index;
+    next_index += message.payload.size();
+    owe_ack(message, in_order);
+  }
+  insert_substrings(batch, reassembler, inbound_stream);
+  adjust_receive_buffer(inbound_stream);
+}
+
+bool TCPReceiver::receive_predicted(const TCPSenderMessage& message,
+                                    Reassembler& reassembler,
+                                    Writer& inbound_stream) {
+  // Nothing held out of order and room for the whole payload: it goes
+  // straight to the stream, with no unwrap, reassembly or SACK blocks
+  if (message.SYN || message.FIN || message.payload.empty() ||
+      !zero_point_.has_value() ||
+      message.seqno != Wrap32::wrap(checkpoint_, zero_point_.value()) ||
+      reassembler.bytes_pending() != 0 || inbound_stream.is_closed() ||
+      message.payload.size() > inbound_stream.available_capacity() ||
+      older_than_ts_recent(message)) {
+    return false;
+  }
+  update_ts_recent(message);
+  checkpoint_ += reassembler.insert_next(message.payload, inbound_stream);
+  // An earlier FIN may have been waiting for these bytes
+  checkpoint_ += inbound_stream.is_closed();
+  owe_ack(message, true);
+  adjust_receive_buffer(inbound_stream);
+  return true;
+}
+
+uint8_t TCPReceiver::scale_for(const TCPSenderMessage& syn,
+                               const Writer& inbound_stream) const {
+  // Scale only if the peer can take it, and then by just enough that the
+  // whole capacity, as far as autotuning may grow it, can be advertised
+  const uint64_t capacity =
+      max(inbound_stream.capacity(),
+          autotune_.has_value() ? autotune_->max_capacity : 0);
+  uint8_t scale = 0;
+  if (syn.window_scale.has_value()) {
+    while (scale < TCPConfig::MAX_WINDOW_SCALE &&
+           (capacity >> scale) > UINT16_MAX) {
+      ++scale;
+    }
+  }
+  return scale;
+}
+
+bool TCPReceiver::is_stale(const TCPSenderMessage& message) const {
+  // Everything in the segment comes before the ackno: a retransmission of
+  // data already written, which can be dropped without an unwrap
+  return message.seqno + static_cast<uint32_t>(message.sequence_length()) <=
+         Wrap32::wrap(checkpoint_, zero_point_.value());
+}
+
+bool TCPReceiver::older_than_ts_recent(
+    const TCPSenderMessage& message) const {
+  return ts_recent_.has_value() && message.tsval.has_value() &&
+         static_cast<int32_t>(*message.tsval - *ts_recent_) < 0;
+}
+
+bool TCPReceiver::fails_paws(const TCPSenderMessage& message) {
+  // An old duplicate (from before the sequence numbers wrapped, say) carries
+  // a TSval from before TS.Recent. Drop it, but acknowledge it.
+  if (!older_than_ts_recent(message)) {
+    return false;
+  }
+  ack_now_ = true;
+  return true;
+}
+
+void TCPReceiver::update_ts_recent(const TCPSenderMessage& message) {
+  // Take the TSval of a segment that starts at or before the last ackno
+  // sent: the ackno now, unless a delayed ACK is being held back, in which
+  // case the earliest TSval since then is already the one to echo
+  if (ts_recent_.has_value() && message.tsval.has_value() && !ack_pending_ &&
+      message.seqno <= Wrap32::wrap(checkpoint_, zero_point_.value())) {
+    ts_recent_ = message.tsval;
+  }
+}
+
+void TCPReceiver::owe_ack(const TCPSenderMessage& message, bool in_order) {
+  // A segment that uses no sequence numbers is itself just an ACK
+  if (message.sequence_length() == 0) {
+    return;
+  }
+  if (!delayed_ack_.has_value() || !in_order || message.SYN || message.FIN) {
+    ack_now_ = true;
+    return;
+  }
+  ack_pending_ = true;
+  if (message.payload.size() >= delayed_ack_->full_segment_size &&
+      ++full_segments_unacked_ >= 2) {
+    ack_now_ = true;
+  }
+}
+
+void TCPReceiver::insert_substrings(
+    span<const Reassembler::Substring> batch, Reassembler& reassembler,
+    Writer& inbound_stream) {
+  if (batch.empty()) {
+    return;
+  }
+  uint64_t bytes_pushed_before = inbound_stream.bytes_pushed();
+  reassembler.insert_batch(batch, inbound_stream);
+  uint64_t bytes_pushed_after = inbound_stream.bytes_pushed();
+  checkpoint_ +=
+      bytes_pushed_after - bytes_pushed_before + inbound_stream.is_closed();
+
+  vector<uint64_t> arrived;
+  for (const auto& substring : batch) {
+    if (substring.length != 0) {
+      arrived.push_back(max(substring.first_index, bytes_pushed_after));
+    }
+  }
+  if (!arrived.empty()) {
+    update_sack_blocks(arrived, reassembler);
+  }
+}
+
+void TCPReceiver::update_sack_blocks(span<const uint64_t> arrived,
+                                     const Reassembler& reassembler) {
+  if (!sack_permitted_) {
+    return;
+  }
+  // RFC 2018: the first blocks hold the segments that just arrived, newest
+  // first, and the rest repeat the most recently reported blocks that are
+  // still held
+  const auto held = reassembler.held_intervals();
+  vector<pair<uint64_t, uint64_t>> blocks;
+  const auto report = [&](uint64_t index) {
+    const auto run = partition_point(
+        held.begin(), held.end(),
+        [&](const auto& range) { return range.second <= index; });
+    if (run != held.end() and run->first <= index and
+        blocks.size() < max_sack_blocks_ and
+        find(blocks.begin(), blocks.end(), *run) == blocks.end()) {
+      blocks.push_back(*run);
+    }
+  };
+
+  for (auto index = arrived.rbegin(); index != arrived.rend(); ++index) {
+    report(*index);
+  }
+  for (const auto& block : sack_blocks_) {
+    report(block.first);
+  }
+  sack_blocks_ = std::move(blocks);
+}
+
+TCPReceiverMessage TCPReceiver::send(const Writer& inbound_stream) {
+  TCPReceiverMessage msg = next_message(inbound_stream);
+  record_advertised_edge(msg, inbound_stream);
+  return msg;
 }
 
-TCPReceiverMessage TCPReceiver::send(const Writer& inbound_stream) const {
+TCPReceiverMessage TCPReceiver::next_message(
+    const Writer& inbound_stream) const {
   TCPReceiverMessage result;
   if (zero_point_.has_value()) {
     result.ackno = Wrap32::wrap(checkpoint_, zero_point_.value());
   }
-  result.window_size = static_cast<uint16_t>(std::min(
-      inbound_stream.available_capacity(), static_cast<uint64_t>(UINT16_MAX)));
+  uint64_t window = inbound_stream.available_capacity();
+  if (capacity_target_.has_value()) {
+    // Until the stream is shrunk on the next segment, reading must not open
+    // the window past where it is headed
+    const uint64_t capacity = retracted_capacity(inbound_stream);
+    const uint64_t buffered =
+        inbound_stream.capacity() - inbound_stream.available_capacity();
+    window = min(window, capacity - min(capacity, buffered));
+  }
+  result.window_size = static_cast<uint16_t>(
+      std::min(window >> window_scale_, static_cast<uint64_t>(UINT16_MAX)));
+  result.window_scale = window_scale_;
+  result.tsecr = ts_recent_;
+  if (zero_point_.has_value()) {
+    // Stream index i is absolute sequence number i + 1 (after the SYN)
+    for (const auto& [first, end] : sack_blocks_) {
+      result.sack_blocks.push_back(
+          SACKBlock{Wrap32::wrap(first + 1, zero_point_.value()),
+                    Wrap32::wrap(end + 1, zero_point_.value())});
+    }
+  }
   return result;
 }
+
+void TCPReceiver::record_advertised_edge(const TCPReceiverMessage& message,
+                                         const Writer& inbound_stream) {
+  if (zero_point_.has_value()) {
+    advertised_edge_ = max(advertised_edge_,
+                           inbound_stream.bytes_pushed() + message.window());
+  }
+}
+
+optional<TCPReceiverMessage> TCPReceiver::maybe_send(
+    const Writer& inbound_stream) {
+  TCPReceiverMessage msg = next_message(inbound_stream);
+
+  // Silly window syndrome avoidance (RFC 1122 4.2.3.3): tell the sender
+  // about a bigger window only once the right edge has moved forward by two
+  // full-sized segments or half the buffer, whichever is less
+  const uint64_t edge = inbound_stream.bytes_pushed() + msg.window();
+  const uint64_t threshold = max<uint64_t>(
+      min(2 * full_segment_size(), inbound_stream.capacity() / 2), 1);
+  const bool window_update =
+      zero_point_.has_value() && edge >= advertised_edge_ + threshold;
+  if (!ack_now_ && !window_update) {
+    return {};
+  }
+
+  ack_now_ = false;
+  ack_pending_ = false;
+  full_segments_unacked_ = 0;
+  ms_since_ack_pending_ = 0;
+  record_advertised_edge(msg, inbound_stream);
+  return msg;
+}
+
+uint64_t TCPReceiver::full_segment_size() const {
+  return delayed_ack_.has_value() ? delayed_ack_->full_segment_size
+                                  : TCPConfig::MAX_PAYLOAD_SIZE;
+}
+
+void TCPReceiver::tick(uint64_t ms_since_last_tick) {
+  ms_elapsed_ += ms_since_last_tick;
+  if (!ack_pending_ || !delayed_ack_.has_value()) {
+    return;
+  }
+  ms_since_ack_pending_ += ms_since_last_tick;
+  if (ms_since_ack_pending_ >= delayed_ack_->delay_ms) {
+    ack_now_ = true;
+  }
+}
+
+void TCPReceiver::adjust_receive_buffer(Writer& inbound_stream) {
+  if (!autotune_.has_value()) {
+    return;
+  }
+  if (capacity_target_.has_value()) {
+    retract_capacity(inbound_stream);
+  }
+  if (!zero_point_.has_value()) {
+    return;
+  }
+  const uint64_t pushed = inbound_stream.bytes_pushed();
+  const uint64_t popped = pushed - (inbound_stream.capacity() -
+                                    inbound_stream.available_capacity());
+  if (!space_start_ms_.has_value()) {
+    // Like Linux's rcvq_space, start from an initial window's worth, so a
+    // reader that keeps up with more than that grows the buffer
+    space_ = min<uint64_t>(inbound_stream.capacity(),
+                           TCPConfig::INITIAL_CWND_SEGMENTS *
+                               full_segment_size());
+    space_start_ms_ = ms_elapsed_;
+    space_start_popped_ = popped;
+  }
+
+  // RTT: time from advertising a window to having received all of it
+  if (rtt_target_.has_value() && pushed >= *rtt_target_) {
+    const uint64_t sample = max<uint64_t>(ms_elapsed_ - rtt_start_ms_, 1);
+    rtt_ms_ = rtt_ms_ == 0 ? sample : (7 * rtt_ms_ + sample) / 8;
+    rtt_target_.reset();
+  }
+  if (!rtt_target_.has_value() && inbound_stream.available_capacity() > 0) {
+    rtt_target_ = pushed + inbound_stream.available_capacity();
+    rtt_start_ms_ = ms_elapsed_;
+  }
+
+  // Once per RTT, make room for twice what the application kept up with
+  if (rtt_ms_ == 0 || ms_elapsed_ - *space_start_ms_ < rtt_ms_) {
+    return;
+  }
+  const uint64_t copied = popped - space_start_popped_;
+  if (copied > space_) {
+    space_ = copied;
+    const uint64_t capacity = min(autotune_->max_capacity, 2 * copied);
+    if (capacity > inbound_stream.capacity() &&
+        !capacity_target_.has_value()) {
+      inbound_stream.set_capacity(capacity);
+    }
+  }
+  space_start_ms_ = ms_elapsed_;
+  space_start_popped_ = popped;
+}
+
+void TCPReceiver::shrink_receive_buffer(Writer& inbound_stream) {
+  if (!autotune_.has_value()) {
+    return;
+  }
+  capacity_target_ = autotune_->min_capacity;
+  retract_capacity(inbound_stream);
+}
+
+uint64_t TCPReceiver::retracted_capacity(const Writer& inbound_stream) const {
+  // RFC 7323 section 2.4: the right edge already advertised stays put, so
+  // the capacity comes down only as the application reads up to it
+  const uint64_t popped = inbound_stream.bytes_pushed() -
+                          (inbound_stream.capacity() -
+                           inbound_stream.available_capacity());
+  const uint64_t edge = max(advertised_edge_, popped);
+  return max(capacity_target_.value_or(0), edge - popped);
+}
+
+void TCPReceiver::retract_capacity(Writer& inbound_stream) {
+  inbound_stream.set_capacity(retracted_capacity(inbound_stream));
+  space_ = min(space_, inbound_stream.capacity());
+  if (inbound_stream.capacity() <= capacity_target_.value_or(0)) {
+    capacity_target_.reset();
+  }
+}
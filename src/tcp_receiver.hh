@@ -1,22 +1,161 @@
 #pragma once
 
+#include <span>
+#include <utility>
+#include <vector>
+
 #include "reassembler.hh"
+#include "tcp_config.hh"
 #include "tcp_receiver_message.hh"
 #include "tcp_sender_message.hh"
 
 class TCPReceiver {
  public:
+  // Delayed ACKs (RFC 1122 and RFC 5681): rather than acknowledging every
+  // segment, wait for a second full-sized one or for `delay_ms` to pass,
+  // unless a segment arrives out of order or carries SYN or FIN
+  struct DelayedAck {
+    uint64_t delay_ms;           // e.g. TCPConfig::ACK_DELAY_DFLT
+    uint64_t full_segment_size;  // e.g. TCPConfig::MAX_PAYLOAD_SIZE
+  };
+
+  // Receive-buffer autotuning, as Linux does between the bounds of
+  // tcp_rmem: once per round trip, grow the inbound stream's capacity to
+  // twice what the application read in that round trip, up to
+  // `max_capacity`, and fall back to `min_capacity` under memory pressure
+  struct Autotune {
+    uint64_t max_capacity;
+    uint64_t min_capacity;
+  };
+
+  /*
+   * Report at most `max_sack_blocks` SACK blocks in each TCPReceiverMessage
+   * (once a SYN permits SACK), if `delayed_ack` is given, let maybe_send()
+   * hold back ACKs, and if `autotune` is given, resize the inbound stream to
+   * fit the connection
+   */
+  explicit TCPReceiver(size_t max_sack_blocks = TCPConfig::MAX_SACK_BLOCKS,
+                       std::optional<DelayedAck> delayed_ack = {},
+                       std::optional<Autotune> autotune = {})
+      : max_sack_blocks_(max_sack_blocks),
+        delayed_ack_(delayed_ack),
+        autotune_(autotune) {}
+
   /*
    * The TCPReceiver receives TCPSenderMessages, inserting their payload into
    * the Reassembler at the correct stream index.
    */
-  void receive(TCPSenderMessage message, Reassembler& reassembler,
+  void receive(const TCPSenderMessage& message, Reassembler& reassembler,
                Writer& inbound_stream);
 
-  /* The TCPReceiver sends TCPReceiverMessages back to the TCPSender. */
-  TCPReceiverMessage send(const Writer& inbound_stream) const;
+  /*
+   * Receive a burst of TCPSenderMessages at once, with the same result as
+   * receiving them in order one at a time, but inserting all their payloads
+   * with one Reassembler::insert_batch.
+   */
+  void receive_batch(std::span<const TCPSenderMessage> messages,
+                     Reassembler& reassembler, Writer& inbound_stream);
+
+  /*
+   * The TCPReceiver sends TCPReceiverMessages back to the TCPSender. The
+   * right edge of the window sent is remembered, and never retracted.
+   */
+  TCPReceiverMessage send(const Writer& inbound_stream);
+
+  /*
+   * Send a TCPReceiverMessage if one is due (or empty optional otherwise):
+   * an ACK for segments received since the last one, subject to delayed
+   * ACKs if enabled, or a window update once the application has read
+   * enough to move the window's right edge forward by two full-sized
+   * segments or half the buffer, whichever is less.
+   */
+  std::optional<TCPReceiverMessage> maybe_send(const Writer& inbound_stream);
+
+  /* Time has passed by the given # of milliseconds since the last time the
+   * tick() method was called. */
+  void tick(uint64_t ms_since_last_tick);
+
+  /*
+   * Memory is short: shrink the inbound stream back to the autotuning
+   * minimum, and let it grow again from there. The window is never pulled
+   * back from an edge already advertised (RFC 1122 4.2.2.16): the stream
+   * keeps room for it, and shrinks further as the application reads.
+   */
+  void shrink_receive_buffer(Writer& inbound_stream);
+
+  /* The receiver's estimate of the round-trip time, or 0 before one sample */
+  uint64_t rtt_estimate_ms() const { return rtt_ms_; }
+
+  /* How many segments did receive() take on the predicted path, and how
+   * many on the general one? */
+  uint64_t predicted_hits() const { return predicted_hits_; }
+  uint64_t predicted_misses() const { return predicted_misses_; }
 
  private:
   std::optional<Wrap32> zero_point_{};
   uint64_t checkpoint_ = 0;
+  uint8_t window_scale_ = 0;     // negotiated by the SYN
+  bool sack_permitted_ = false;  // likewise
+
+  uint8_t scale_for(const TCPSenderMessage& syn,
+                    const Writer& inbound_stream) const;
+  bool is_stale(const TCPSenderMessage& message) const;
+
+  // Header prediction (Van Jacobson): the common case of a data segment
+  // carrying exactly the next expected bytes
+  bool receive_predicted(const TCPSenderMessage& message,
+                         Reassembler& reassembler, Writer& inbound_stream);
+  uint64_t predicted_hits_ = 0;
+  uint64_t predicted_misses_ = 0;
+
+  // RFC 7323 timestamps: the TSval to echo (TS.Recent), and PAWS, which
+  // drops a segment whose TSval is older than it
+  std::optional<uint32_t> ts_recent_{};
+  bool older_than_ts_recent(const TCPSenderMessage& message) const;
+  bool fails_paws(const TCPSenderMessage& message);
+  void update_ts_recent(const TCPSenderMessage& message);
+  void owe_ack(const TCPSenderMessage& message, bool in_order);
+  void insert_substrings(std::span<const Reassembler::Substring> batch,
+                         Reassembler& reassembler, Writer& inbound_stream);
+
+  // The out-of-order runs held by the Reassembler, as stream indices, in the
+  // order they will be reported as SACK blocks. `arrived` holds the stream
+  // index of each payload just received, oldest first.
+  void update_sack_blocks(std::span<const uint64_t> arrived,
+                          const Reassembler& reassembler);
+  size_t max_sack_blocks_;
+  std::vector<std::pair<uint64_t, uint64_t>> sack_blocks_{};
+
+  // The next TCPReceiverMessage, and the window's right edge (a stream index)
+  // once it has been sent
+  TCPReceiverMessage next_message(const Writer& inbound_stream) const;
+  void record_advertised_edge(const TCPReceiverMessage& message,
+                              const Writer& inbound_stream);
+
+  // ACK state for maybe_send()
+  std::optional<DelayedAck> delayed_ack_;
+  uint64_t full_segment_size() const;  // the MSS, for SWS and autotuning
+  bool ack_now_ = false;
+  bool ack_pending_ = false;
+  uint64_t full_segments_unacked_ = 0;
+  uint64_t ms_since_ack_pending_ = 0;
+  uint64_t advertised_edge_ = 0;  // stream index just past the last window
+
+  // Autotuning state. The RTT is measured as the time to receive one full
+  // window, which needs nothing from the sender (Linux's rcv_rtt_est).
+  void adjust_receive_buffer(Writer& inbound_stream);
+  std::optional<Autotune> autotune_;
+  uint64_t ms_elapsed_ = 0;
+  uint64_t rtt_ms_ = 0;
+  std::optional<uint64_t> rtt_target_{};  // stream index ending the sample
+  uint64_t rtt_start_ms_ = 0;
+  uint64_t space_ = 0;  // most bytes read in one RTT, or the initial window
+  std::optional<uint64_t> space_start_ms_{};
+  uint64_t space_start_popped_ = 0;
+
+  // Shrinking under memory pressure: the capacity still to be reached, and
+  // how far it can come down now without retracting the advertised edge
+  std::optional<uint64_t> capacity_target_{};
+  uint64_t retracted_capacity(const Writer& inbound_stream) const;
+  void retract_capacity(Writer& inbound_stream);
 };
@@ -1,21 +1,38 @@
 #pragma once
 
+#include <algorithm>
+#include <optional>
+
 #include "byte_stream.hh"
+#include "congestion_control.hh"
+#include "retransmission_queue.hh"
+#include "rtt_estimator.hh"
 #include "tcp_receiver_message.hh"
 #include "tcp_sender_message.hh"
 
-#include <map> 
-
-class TCPSender {
+/*
+ * A TCP sender whose congestion control is the policy `CC` (see
+ * congestion_control.hh). It sends no more than the smaller of the receiver's
+ * window and the policy's cwnd(), spaced out at its pacing_rate() if it has
+ * one, and if the policy asks for it, retransmits the oldest segment after
+ * TCPConfig::DUP_ACK_THRESHOLD duplicate ACKs.
+ */
+template <typename CC>
+class BasicTCPSender {
   Wrap32 isn_;
   uint64_t initial_RTO_ms_;
-  uint16_t window_size_ = 1; 
+  uint64_t window_size_ = 1;  // in sequence numbers, already unscaled
   uint64_t flight_checkpoint_ = 0; 
-  uint64_t outstanding_checkpoint_ = 0; 
   bool syn_send_ = false; 
   bool fin_send_ = false; 
-  std::map<uint64_t, TCPSenderMessage> flight_message_map_; 
-  std::map<uint64_t, TCPSenderMessage> outstanding_message_map_; 
+  // Segments [0, next_to_send_) of the queue are outstanding, and the rest
+  // are waiting for maybe_send(). After a timeout a policy that recovers
+  // from loss goes back to the front, so [next_to_send_, sent_high_) were
+  // sent before and are presumed lost.
+  RetransmissionQueue queue_{};
+  size_t next_to_send_ = 0;
+  size_t sent_high_ = 0;
+  bool retransmit_front_ = false;  // the RTO expired for queue_.front()
   uint64_t bytes_flight_ = 0; 
 
   // resend
@@ -23,11 +40,39 @@ class TCPSender {
   bool clock_started_ = false; 
   uint64_t current_RT0_ms_;
   uint64_t retransmissions_ = 0;
+  // If set, the RTO adapts to the path (RFC 6298) rather than resetting to
+  // initial_RTO_ms_ on every ACK
+  std::optional<RTTEstimator> rtt_estimator_;
+  uint64_t base_RTO_ms() const;
+
+  // RTT samples from timestamps (RFC 7323): each segment carries the time it
+  // was last sent, so an ACK for a retransmission is no longer ambiguous
+  uint64_t ms_elapsed_ = 0;
+  std::optional<uint64_t> rtt_sample_ms_{};
+
+  // Delivery rate: sequence numbers acknowledged so far and when the last
+  // were, and when the segment that began the current interval was sent
+  uint64_t delivered_ = 0;
+  uint64_t delivered_ms_ = 0;
+  uint64_t first_sent_ms_ = 0;
+
+  // Congestion control, and the duplicate ACKs that signal a loss to it.
+  // A policy with a pacing rate has sends spend a budget that tick() refills.
+  CC congestion_control_;
+  double pacing_budget_ = 0;
+  uint64_t duplicate_acks_ = 0;
+  LossEvent loss_event() const;
+  // Sent and not yet acknowledged, unlike bytes_flight_, which also counts
+  // segments queued behind the pacing budget
+  uint64_t bytes_sent_unacked() const;
 
  public:
   /* Construct TCP sender with given default Retransmission Timeout and possible
-   * ISN */
-  TCPSender(uint64_t initial_RTO_ms, std::optional<Wrap32> fixed_isn);
+   * ISN, and if `adaptive_RTO` is given, estimate the RTO from RTT samples
+   * within its bounds, starting from the default */
+  BasicTCPSender(uint64_t initial_RTO_ms, std::optional<Wrap32> fixed_isn,
+                 CC congestion_control = CC{},
+                 std::optional<RTTEstimator::Bounds> adaptive_RTO = {});
 
   /* Push bytes from the outbound stream */
   void push(Reader& outbound_stream);
@@ -50,4 +95,259 @@ class TCPSender {
       const;  // How many sequence numbers are outstanding?
   uint64_t consecutive_retransmissions()
       const;  // How many consecutive *re*transmissions have happened?
+  std::optional<uint64_t> rtt_sample_ms()
+      const;  // RTT measured by the latest ACK of new data, if any
+  uint64_t delivered() const;  // How many sequence numbers were acknowledged?
+  uint64_t rto_ms() const;     // What is the retransmission timeout now?
+  std::optional<uint64_t> srtt_ms()
+      const;  // Smoothed RTT, if the RTO is adaptive and has a sample
+  std::optional<uint64_t> rttvar_ms()
+      const;  // RTT variation, if the RTO is adaptive and has a sample
+  const CC& congestion_control() const { return congestion_control_; }
 };
+
+// The per-segment and per-ACK paths are defined here, inline, so that a
+// sender with a concrete policy can inline its hooks; the rest of the class
+// is compiled once, in tcp_sender.cc
+
+template <typename CC>
+inline uint64_t BasicTCPSender<CC>::base_RTO_ms() const {
+  return rtt_estimator_.has_value() ? rtt_estimator_->rto_ms()
+                                    : initial_RTO_ms_;
+}
+
+template <typename CC>
+inline uint64_t BasicTCPSender<CC>::bytes_sent_unacked() const {
+  return next_to_send_ == 0
+             ? 0
+             : queue_[next_to_send_ - 1].end() - queue_.front().seqno;
+}
+
+/*
+  如果TCPSender愿意，
+  这是TCPSender实际发送TCPSenderMessage的机会。
+*/
+template <typename CC>
+inline std::optional<TCPSenderMessage> BasicTCPSender<CC>::maybe_send() {
+  if (!retransmit_front_ && next_to_send_ == queue_.size()) {
+    return std::optional<TCPSenderMessage>();
+  }
+  // The window may have shrunk since the segment was queued
+  if (!retransmit_front_ && next_to_send_ != 0 &&
+      bytes_sent_unacked() + queue_[next_to_send_].message.sequence_length() >
+          congestion_control_.cwnd()) {
+    return std::optional<TCPSenderMessage>();
+  }
+  const bool paced = congestion_control_.pacing_rate().has_value();
+  if (paced && pacing_budget_ <= 0) {
+    return std::optional<TCPSenderMessage>();
+  }
+  if (sent_high_ == 0 && !clock_started_) {
+    clock_started_ = true; 
+    retransmissions_ = 0;
+    ms_since_first_tick_ = 0;
+    current_RT0_ms_ = base_RTO_ms();
+  }
+
+  // A segment whose RTO expired goes before anything new
+  const bool idle = sent_high_ == 0;
+  const bool resent = retransmit_front_ || next_to_send_ < sent_high_;
+  RetransmissionQueue::Segment &segment =
+      retransmit_front_ ? queue_.front() : queue_[next_to_send_++];
+  segment.retransmitted = resent;
+  sent_high_ = std::max(sent_high_, next_to_send_);
+  retransmit_front_ = false;
+
+  // Record what a rate sample from this segment's ACK will measure from. A
+  // send with nothing outstanding starts a new interval.
+  if (idle) {
+    first_sent_ms_ = ms_elapsed_;
+    delivered_ms_ = ms_elapsed_;
+  }
+  segment.sent_ms = ms_elapsed_;
+  segment.delivered = delivered_;
+  segment.delivered_ms = delivered_ms_;
+  segment.first_sent_ms = first_sent_ms_;
+  if (paced) {
+    pacing_budget_ -= static_cast<double>(segment.message.sequence_length());
+  }
+
+  TCPSenderMessage msg_to_send = segment.message;
+
+  // Stamp every (re)transmission with the time it leaves
+  msg_to_send.tsval = static_cast<uint32_t>(ms_elapsed_);
+  return msg_to_send;
+}
+
+/*
+  TCPSender被要求从出站字节流中填充窗口：只要有新的字节要读取和窗口中可用的空间，
+  它就会从流中读取并生成尽可能多的TCPSenderMessages。您需要确保您发送的每个
+  TCPSenderMessage都完全适合接收器的窗口。使每条消息尽可能大，
+  但不要大于TCPConfig::MAX_PAYLOAD_SIZE（1452字节）给出的值。
+  您可以使用TCPSenderMessage::sequence_length()方法来计算一个段占用的序列号总数。
+  请记住，SYN和FIN标志也分别占据一个序列号，这意味着它们占据了窗口中的空间
+*/
+template <typename CC>
+inline void BasicTCPSender<CC>::push(Reader& outbound_stream) {
+  do {
+    uint64_t window_size = window_size_ == 0 ? 1 : window_size_;
+    window_size = std::min(window_size, congestion_control_.cwnd());
+    TCPSenderMessage msg; 
+    // SYN
+    if (outbound_stream.bytes_popped() == 0 && !syn_send_) {
+      msg.SYN = true; 
+      syn_send_ = true; 
+      // Offer to take scaled windows (RFC 7323). The TCPSender advertises
+      // no windows itself, so it asks for no scaling of its own.
+      msg.window_scale = 0;
+    }
+
+    // Bytes
+    if (window_size - msg.SYN > bytes_flight_) {
+      uint64_t allow_bytes_size = window_size - msg.SYN - bytes_flight_;
+      uint64_t bytes_should_pop = std::min(TCPConfig::MAX_PAYLOAD_SIZE, 
+                                           std::min(allow_bytes_size, 
+                                                       outbound_stream.bytes_buffered())); 
+
+      // Only the bytes that fit are taken, and a pushed chunk of exactly
+      // that size is shared rather than copied
+      msg.payload = outbound_stream.pop_buffer(bytes_should_pop); 
+
+      // FIN
+      if (outbound_stream.is_finished() && 
+          allow_bytes_size > bytes_should_pop &&
+          !fin_send_) {
+        msg.FIN = true; 
+        fin_send_ = true; 
+      }
+    }
+
+    // seqno
+    msg.seqno = Wrap32::wrap(flight_checkpoint_, isn_); 
+
+    // don't send empty!!
+    if (msg.sequence_length() == 0) {
+      break; 
+    }
+
+    // mark flight
+    queue_.push_back({flight_checkpoint_, msg});
+    flight_checkpoint_ += msg.sequence_length();
+    bytes_flight_ += msg.sequence_length(); 
+  } while (outbound_stream.bytes_buffered() != 0); 
+}
+
+/*
+  从接收器收到一条消息，
+  传达窗口的new left（= ackno）new right（= ackno +窗口大小）边缘。
+  TCPSender应该查看其未完成段的集合，
+  并删除任何现已完全确认的段（ackno大于段中的所有序号）。
+*/
+template <typename CC>
+inline void BasicTCPSender<CC>::receive(const TCPReceiverMessage &msg) {
+  if (msg.ackno.has_value() && sent_high_ != 0) {
+    // Only an ackno past the oldest outstanding seqno, and no further than
+    // the end of what has been sent, can acknowledge anything. Checking that
+    // needs no unwrap: the ackno's distance from the oldest seqno is enough.
+    const uint64_t oldest = queue_.front().seqno;
+    const Wrap32 oldest_seqno = Wrap32::wrap(oldest, isn_);
+    const uint64_t checkpoint =
+        oldest + static_cast<uint32_t>(*msg.ackno - oldest_seqno);
+    const bool ackno_in_flight = msg.ackno->in_window(
+        oldest_seqno + 1, queue_[sent_high_ - 1].end() - oldest);
+
+    // Segments are acknowledged whole: the ackno must fall on a boundary
+    const size_t acked =
+        ackno_in_flight ? queue_.count_ending_by(checkpoint, sent_high_)
+                        : 0;
+    if (acked != 0 && queue_[acked - 1].end() == checkpoint) {
+      const uint64_t sent_unacked_before = bytes_sent_unacked();
+
+      // Rate sample: what was delivered since the newest acknowledged
+      // segment was sent, over the longer of its send and ACK intervals
+      const RetransmissionQueue::Segment &newest = queue_[acked - 1];
+      delivered_ += checkpoint - oldest;
+      delivered_ms_ = ms_elapsed_;
+      const uint64_t prior_delivered = newest.delivered;
+      const uint64_t interval_ms =
+          std::max(newest.sent_ms - newest.first_sent_ms,
+              delivered_ms_ - newest.delivered_ms);
+      std::optional<double> delivery_rate;
+      if (interval_ms != 0) {
+        delivery_rate = static_cast<double>(delivered_ - prior_delivered) /
+                        static_cast<double>(interval_ms);
+      }
+      first_sent_ms_ = newest.sent_ms;
+
+      // Without a timestamp, only an ACK covering no retransmission gives an
+      // unambiguous RTT (Karn's algorithm): a resent segment may be what
+      // let the receiver's ackno jump past later ones
+      std::optional<uint64_t> rtt_ms;
+      bool retransmission_acked = false;
+      for (size_t i = 0; i < acked; ++i) {
+        retransmission_acked = retransmission_acked || queue_[i].retransmitted;
+      }
+      if (!retransmission_acked) {
+        rtt_ms = ms_elapsed_ - newest.sent_ms;
+      }
+      queue_.pop_front(acked);
+      // A late ACK may cover segments not yet resent since a timeout
+      next_to_send_ -= std::min(acked, next_to_send_);
+      sent_high_ -= acked;
+      bytes_flight_ -= checkpoint - oldest;
+      retransmit_front_ = false;
+      clock_started_ = true; 
+      retransmissions_ = 0;
+      ms_since_first_tick_ = 0;
+      duplicate_acks_ = 0;
+
+      // The echoed TSval is when the segment that advanced the receiver's
+      // ackno was sent, whether or not it was a retransmission
+      if (msg.tsecr.has_value()) {
+        rtt_ms = static_cast<uint32_t>(ms_elapsed_) - *msg.tsecr;
+        rtt_sample_ms_ = rtt_ms;
+      }
+
+      // Karn's algorithm: without an unambiguous sample, an adaptive RTO
+      // keeps its backoff
+      if (rtt_estimator_.has_value() && rtt_ms.has_value()) {
+        rtt_estimator_->sample(*rtt_ms);
+      }
+      current_RT0_ms_ = base_RTO_ms();
+      congestion_control_.on_ack(AckEvent{checkpoint - oldest, checkpoint,
+                                          sent_unacked_before, ms_elapsed_,
+                                          rtt_ms, delivered_, prior_delivered,
+                                          delivery_rate});
+
+      // Still recovering: the next hole was lost too
+      if (congestion_control_.in_recovery() && next_to_send_ != 0) {
+        retransmit_front_ = true;
+      }
+    } else if (congestion_control_.fast_retransmit() &&
+               *msg.ackno == oldest_seqno && msg.window() == window_size_ &&
+               ++duplicate_acks_ == TCPConfig::DUP_ACK_THRESHOLD &&
+               !congestion_control_.in_recovery()) {
+      // Fast retransmit (RFC 5681): the receiver keeps asking for the oldest
+      // segment while later ones arrive
+      congestion_control_.on_loss(loss_event());
+      retransmit_front_ = true;
+    }
+
+    if (sent_high_ == 0) {
+      clock_started_ = false; 
+    }
+  }
+
+  window_size_ = msg.window();
+}
+
+// The policies instantiated in tcp_sender.cc
+extern template class BasicTCPSender<NoCongestionControl>;
+extern template class BasicTCPSender<Reno>;
+extern template class BasicTCPSender<NewReno>;
+extern template class BasicTCPSender<Cubic>;
+extern template class BasicTCPSender<BBR>;
+extern template class BasicTCPSender<AnyCongestionControl>;
+
+// Sends whatever the receiver's window allows, as a plain lab TCPSender does
+using TCPSender = BasicTCPSender<NoCongestionControl>;
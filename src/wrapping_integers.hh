@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <span>
 
 /*
  * The Wrap32 type represents a 32-bit unsigned integer that:
@@ -13,11 +14,13 @@ class Wrap32 {
   uint32_t raw_value_{};
 
  public:
-  explicit Wrap32(uint32_t raw_value) : raw_value_(raw_value) {}
+  constexpr explicit Wrap32(uint32_t raw_value) : raw_value_(raw_value) {}
 
   /* Construct a Wrap32 given an absolute sequence number n and the zero point.
    */
-  static Wrap32 wrap(uint64_t n, Wrap32 zero_point);
+  static constexpr Wrap32 wrap(uint64_t n, Wrap32 zero_point) {
+    return Wrap32{static_cast<uint32_t>(n + zero_point.raw_value_)};
+  }
 
   /*
    * The unwrap method returns an absolute sequence number that wraps to this
@@ -28,10 +31,54 @@ class Wrap32 {
    * Wrap32. The unwrap method should return the one that is closest to the
    * checkpoint.
    */
-  uint64_t unwrap(Wrap32 zero_point, uint64_t checkpoint) const;
+  constexpr uint64_t unwrap(Wrap32 zero_point, uint64_t checkpoint) const {
+    // The signed distance from the checkpoint's own wrapped value picks the
+    // closest candidate, unless that would fall below zero, in which case the
+    // next one up is the closest that exists
+    const auto diff = static_cast<int32_t>(
+        raw_value_ - wrap(checkpoint, zero_point).raw_value_);
+    const uint64_t result = checkpoint + static_cast<int64_t>(diff);
+    return result + (static_cast<uint64_t>(result > checkpoint and diff < 0)
+                     << 32);
+  }
 
-  Wrap32 operator+(uint32_t n) const { return Wrap32{raw_value_ + n}; }
-  bool operator==(const Wrap32& other) const {
+  /*
+   * Unwrap each of `values` against the same zero point and checkpoint into
+   * `out` (which must be at least as long), e.g. for a burst of ACKs. The loop
+   * has no branches, so the compiler is free to vectorize it.
+   */
+  static void unwrap_batch(std::span<const Wrap32> values, Wrap32 zero_point,
+                           uint64_t checkpoint, std::span<uint64_t> out);
+
+  constexpr Wrap32 operator+(uint32_t n) const {
+    return Wrap32{raw_value_ + n};
+  }
+  constexpr bool operator==(const Wrap32& other) const {
     return raw_value_ == other.raw_value_;
   }
+
+  /*
+   * Serial-number arithmetic (RFC 1982): `a - b` is how far `b` must advance
+   * to reach `a`, as a signed distance of less than 2^31 either way, and
+   * `b < a` means `a` is ahead of `b` by such a distance. None of these need
+   * a zero point or checkpoint, but they only make sense for numbers less
+   * than 2^31 apart, and two numbers exactly 2^31 apart are not ordered
+   * either way.
+   */
+  constexpr int32_t operator-(Wrap32 other) const {
+    return static_cast<int32_t>(raw_value_ - other.raw_value_);
+  }
+  constexpr bool operator<(Wrap32 other) const {
+    return other - *this > 0;
+  }
+  constexpr bool operator<=(Wrap32 other) const {
+    return *this == other or *this < other;
+  }
+  constexpr bool operator>(Wrap32 other) const { return other < *this; }
+  constexpr bool operator>=(Wrap32 other) const { return other <= *this; }
+
+  /* Is this in the `size` sequence numbers starting at `left`? */
+  constexpr bool in_window(Wrap32 left, uint64_t size) const {
+    return raw_value_ - left.raw_value_ < size;
+  }
 };
@@ -95,6 +95,41 @@ int main() {
       test.execute(Peek{"a"});
       test.execute(BytesBuffered{1});
     }
+
+    for (const auto storage :
+         {ByteStream::Storage::ring, ByteStream::Storage::chunked,
+          ByteStream::Storage::pooled}) {
+      ByteStreamTestHarness test{"set_capacity", 4, storage};
+      test.execute(Push{"abcd"});
+      test.execute(AvailableCapacity{0});
+      test.execute(SetCapacity{10});
+      test.execute(AvailableCapacity{6});
+      test.execute(Push{"efghijklm"});
+      test.execute(BytesBuffered{10});
+      test.execute(Pop{3});
+      test.execute(SetCapacity{2});
+      test.execute(AvailableCapacity{0});
+      test.execute(Peek{"defghij"});
+      test.execute(Pop{6});
+      test.execute(SetCapacity{2});
+      test.execute(AvailableCapacity{1});
+      test.execute(Pop{1});
+      test.execute(SetCapacity{0});
+      test.execute(AvailableCapacity{0});
+      test.execute(SetCapacity{3});
+      test.execute(Push{"xyzw"});
+      test.execute(ReadAll{"xyz"});
+    }
+
+    {
+      ByteStreamTestHarness test{"set_capacity spsc", 4,
+                                 ByteStream::Storage::spsc};
+      test.execute(SetCapacity{100});
+      test.execute(AvailableCapacity{4});
+      test.execute(SetCapacity{2});
+      test.execute(Push{"abc"});
+      test.execute(ReadAll{"ab"});
+    }
   } catch (const exception &e) {
     cerr << "Exception: " << e.what() << endl;
     return EXIT_FAILURE;
@@ -0,0 +1,151 @@
+#include <malloc.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "byte_stream.hh"
+#include "chunk_pool.hh"
+
+using namespace std;
+using namespace std::chrono;
+
+// Everything malloc has handed out, including the large blocks it maps
+// separately (such as the pool's slabs)
+size_t heap_in_use() {
+  const auto info = mallinfo2();
+  return info.uordblks + info.hblkhd;
+}
+
+void speed_test(
+    const size_t num_streams,  // NOLINT(bugprone-easily-swappable-parameters)
+    const size_t capacity,     // NOLINT(bugprone-easily-swappable-parameters)
+    const size_t burst_size,   // NOLINT(bugprone-easily-swappable-parameters)
+    const size_t num_rounds,   // NOLINT(bugprone-easily-swappable-parameters)
+    const size_t num_threads,  // NOLINT(bugprone-easily-swappable-parameters)
+    const ByteStream::Storage storage) {
+  // Generate the data to be written
+  const string data = [&burst_size] {
+    default_random_engine rd{1729};
+    uniform_int_distribution<char> ud;
+    string ret;
+    for (size_t i = 0; i < burst_size; ++i) {
+      ret += ud(rd);
+    }
+    return ret;
+  }();
+
+  const size_t heap_before = heap_in_use();
+  vector<ByteStream> streams(num_streams, ByteStream{capacity, storage});
+
+  // Each round, every stream receives a burst and then drains to idle. The
+  // streams are split between threads, each with its own.
+  atomic<size_t> bytes_checked = 0;
+  const auto run = [&](size_t first, size_t last) {
+    for (size_t round = 0; round < num_rounds; ++round) {
+      for (size_t i = first; i < last; ++i) {
+        streams[i].writer().push(data);
+      }
+      for (size_t i = first; i < last; ++i) {
+        Reader &reader = streams[i].reader();
+        while (reader.bytes_buffered()) {
+          const auto peeked = reader.peek();
+          bytes_checked +=
+              peeked.front() == data[reader.bytes_popped() % burst_size];
+          reader.pop(peeked.size());
+        }
+      }
+    }
+  };
+  const auto start_time = steady_clock::now();
+  vector<thread> threads;
+  for (size_t t = 0; t < num_threads; ++t) {
+    threads.emplace_back(run, num_streams * t / num_threads,
+                         num_streams * (t + 1) / num_threads);
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  const auto stop_time = steady_clock::now();
+
+  if (bytes_checked == 0) {
+    throw runtime_error("Mismatch between data written and read");
+  }
+
+  // What the idle streams still cost, with every slab they no longer need
+  // given back
+  if (storage == ByteStream::Storage::pooled) {
+    ChunkPool::global().trim();
+  }
+  const double idle_bytes_per_stream =
+      static_cast<double>(heap_in_use() - heap_before) /
+      static_cast<double>(num_streams);
+
+  auto test_duration = duration_cast<duration<double>>(stop_time - start_time);
+  auto bytes_per_second =
+      static_cast<double>(num_streams * burst_size * num_rounds) /
+      test_duration.count();
+  auto gigabits_per_second = 8 * bytes_per_second / 1e9;
+
+  const string storage_name =
+      storage == ByteStream::Storage::pooled ? "pooled" : "ring";
+
+  fstream debug_output;
+  debug_output.open("/dev/tty");
+
+  cout << num_streams << " ByteStreams (" << storage_name
+       << ") on " << num_threads << " thread(s) with capacity=" << capacity
+       << ", burst_size=" << burst_size
+       << " reached " << fixed << setprecision(2) << gigabits_per_second
+       << " Gbit/s and hold " << setprecision(0) << idle_bytes_per_stream
+       << " bytes each when idle.\n";
+
+  debug_output << "             " << num_streams << " ByteStreams ("
+               << storage_name << ") throughput: " << fixed << setprecision(2)
+               << gigabits_per_second << " Gbit/s, " << setprecision(0)
+               << idle_bytes_per_stream << " bytes per idle stream\n";
+
+  if (storage == ByteStream::Storage::pooled) {
+    const ChunkPool &pool = ChunkPool::global();
+    cout << "    chunk pool: " << pool.chunks_in_use() << " chunks in use, "
+         << pool.high_water_mark() << " high-water mark, "
+         << pool.chunks_allocated() << " allocated.\n";
+    if (pool.chunks_in_use() != 0) {
+      throw runtime_error("Idle pooled ByteStreams still hold chunks");
+    }
+    if (idle_bytes_per_stream >= ChunkPool::kChunkSize) {
+      throw runtime_error("Idle pooled ByteStreams hold a chunk's worth each");
+    }
+  }
+
+  if (gigabits_per_second < 0.05) {
+    throw runtime_error(
+        "ByteStreams did not meet minimum speed of 0.05 Gbit/s.");
+  }
+}
+
+void program_body() {
+  for (const auto storage :
+       {ByteStream::Storage::ring, ByteStream::Storage::pooled}) {
+    speed_test(10000, 64000, 6000, 20, 1, storage);
+  }
+  // Streams on different threads share the pool
+  speed_test(10000, 64000, 6000, 20, 4, ByteStream::Storage::pooled);
+}
+
+int main() {
+  try {
+    program_body();
+  } catch (const exception &e) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,168 @@
+#include <exception>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <utility>
+
+#include "byte_stream.hh"
+#include "common.hh"
+#include "file_descriptor.hh"
+
+using namespace std;
+
+// A ByteStream fed from the read end of a pipe through
+// FileDescriptor::read(Writer::writable_spans())
+struct PipeStream {
+  ByteStream stream;
+  FileDescriptor read_end;
+  FileDescriptor write_end;
+};
+
+namespace {
+
+PipeStream make_pipe_stream(uint64_t capacity) {
+  int fds[2];
+  CheckSystemCall("pipe", ::pipe(fds));
+  return {ByteStream{capacity}, FileDescriptor{fds[0]}, FileDescriptor{fds[1]}};
+}
+
+}  // namespace
+
+class PipeStreamTestHarness : public TestHarness<PipeStream> {
+ public:
+  PipeStreamTestHarness(std::string test_name, uint64_t capacity)
+      : TestHarness(move(test_name), "capacity=" + to_string(capacity),
+                    make_pipe_stream(capacity)) {}
+};
+
+struct WriteToPipe : public Action<PipeStream> {
+  string data_;
+
+  explicit WriteToPipe(string data) : data_(move(data)) {}
+  string description() const override {
+    return "write \"" + Printer::prettify(data_) + "\" into the pipe";
+  }
+  void execute(PipeStream &ps) const override { ps.write_end.write(data_); }
+};
+
+struct ClosePipe : public Action<PipeStream> {
+  string description() const override { return "close the pipe's write end"; }
+  void execute(PipeStream &ps) const override { ps.write_end.close(); }
+};
+
+// Read up to `len` bytes from the pipe straight into the stream's buffer
+struct ReadFromPipe : public ExpectNumber<PipeStream, size_t> {
+  uint64_t len_;
+
+  ReadFromPipe(uint64_t len, size_t bytes_read)
+      : ExpectNumber(bytes_read), len_(len) {}
+  string description() const override {
+    return "read into writable_spans(" + to_string(len_) +
+           ") and commit = " + to_string(num_);
+  }
+  string name() const override { return "bytes read"; }
+  size_t value(PipeStream &ps) const override {
+    const size_t bytes_read =
+        ps.read_end.read(ps.stream.writer().writable_spans(len_));
+    ps.stream.writer().commit(bytes_read);
+    return bytes_read;
+  }
+};
+
+struct SpanCount : public ExpectNumber<PipeStream, size_t> {
+  uint64_t len_;
+
+  SpanCount(uint64_t len, size_t count) : ExpectNumber(count), len_(len) {}
+  string name() const override {
+    return "writable_spans(" + to_string(len_) + ").size()";
+  }
+  size_t value(PipeStream &ps) const override {
+    return ps.stream.writer().writable_spans(len_).size();
+  }
+};
+
+struct PipeEof : public ExpectBool<PipeStream> {
+  using ExpectBool::ExpectBool;
+  string name() const override { return "eof"; }
+  bool value(PipeStream &ps) const override { return ps.read_end.eof(); }
+};
+
+struct ReadStream : public Action<PipeStream> {
+  string data_;
+
+  explicit ReadStream(string data) : data_(move(data)) {}
+  string description() const override {
+    return "pop \"" + Printer::prettify(data_) + "\" from the stream";
+  }
+  void execute(PipeStream &ps) const override {
+    string actual;
+    Reader &reader = ps.stream.reader();
+    while (reader.bytes_buffered()) {
+      const auto peeked = reader.peek();
+      actual += peeked;
+      reader.pop(peeked.size());
+    }
+    if (actual != data_) {
+      throw ExpectationViolation{"Expected \"" + Printer::prettify(data_) +
+                                 "\" in the stream, but found \"" +
+                                 Printer::prettify(actual) + "\""};
+    }
+  }
+};
+
+int main() {
+  try {
+    {
+      PipeStreamTestHarness test{"readv-basic", 16};
+
+      test.execute(WriteToPipe{"hello"});
+      test.execute(ReadFromPipe{16, 5});
+      test.execute(ReadStream{"hello"});
+    }
+
+    {
+      PipeStreamTestHarness test{"readv-wrap-around", 8};
+
+      test.execute(WriteToPipe{"abcdef"});
+      test.execute(ReadFromPipe{8, 6});
+      test.execute(ReadStream{"abcdef"});
+
+      // The free space now crosses the end of the ring, so one readv() fills
+      // both halves
+      test.execute(SpanCount{8, 2});
+      test.execute(WriteToPipe{"ghijklmn"});
+      test.execute(ReadFromPipe{8, 8});
+      test.execute(ReadStream{"ghijklmn"});
+    }
+
+    {
+      PipeStreamTestHarness test{"readv-more-than-requested", 16};
+
+      // The pipe holds more than the spans ask for: readv() stops at the
+      // spans' total and leaves the rest for the next read
+      test.execute(WriteToPipe{"0123456789"});
+      test.execute(ReadFromPipe{4, 4});
+      test.execute(ReadStream{"0123"});
+      test.execute(ReadFromPipe{16, 6});
+      test.execute(ReadStream{"456789"});
+      test.execute(PipeEof{false});
+    }
+
+    {
+      PipeStreamTestHarness test{"readv-eof", 8};
+
+      test.execute(WriteToPipe{"xyz"});
+      test.execute(ClosePipe{});
+      test.execute(ReadFromPipe{8, 3});
+      test.execute(PipeEof{false});
+      test.execute(ReadFromPipe{8, 0});
+      test.execute(PipeEof{true});
+      test.execute(ReadStream{"xyz"});
+    }
+  } catch (const exception &e) {
+    cerr << "Exception: " << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,103 @@
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string_view>
+
+#include "byte_stream.hh"
+#include "byte_stream_test_harness.hh"
+
+using namespace std;
+
+int main() {
+  try {
+    for (const auto storage :
+         {ByteStream::Storage::ring, ByteStream::Storage::chunked,
+          ByteStream::Storage::spsc, ByteStream::Storage::pooled}) {
+      {
+        ByteStreamTestHarness test{"spans-write-read", 8, storage};
+
+        test.execute(PushThroughSpans{"cat"});
+        test.execute(BytesPushed{3});
+        test.execute(AvailableCapacity{5});
+        test.execute(PeekSpans{"cat"});
+
+        test.execute(Push{"tac"});
+        test.execute(PeekSpans{"cattac"});
+        test.execute(Peek{"cattac"});
+
+        test.execute(Pop{5});
+        test.execute(PeekSpans{"c"});
+        test.execute(AvailableCapacity{7});
+      }
+
+      {
+        ByteStreamTestHarness test{"spans-wrap-around", 8, storage};
+
+        test.execute(Push{"abcdef"});
+        test.execute(Pop{5});
+
+        // Crosses the end of an 8-byte ring
+        test.execute(PushThroughSpans{"ghijklm"});
+        test.execute(BytesPushed{13});
+        test.execute(BytesBuffered{8});
+        test.execute(AvailableCapacity{0});
+        test.execute(PeekSpans{"fghijklm"});
+        test.execute(Peek{"fghijklm"});
+
+        test.execute(Pop{4});
+        test.execute(PeekSpans{"jklm"});
+      }
+
+      {
+        ByteStreamTestHarness test{"spans-capacity", 4, storage};
+
+        test.execute(PushThroughSpans{"abcdefg"});
+        test.execute(BytesPushed{4});
+        test.execute(AvailableCapacity{0});
+        test.execute(PeekSpans{"abcd"});
+
+        test.execute(PushThroughSpans{"h"});
+        test.execute(BytesPushed{4});
+        test.execute(PeekSpans{"abcd"});
+
+        test.execute(Close{});
+        test.execute(ReadAll{"abcd"});
+        test.execute(IsFinished{true});
+        test.execute(PeekSpans{""});
+      }
+
+      {
+        ByteStreamTestHarness test{"pop-buffer", 8, storage};
+
+        test.execute(Push{"abcdef"});
+        test.execute(PopBuffer{2, "ab"});
+        test.execute(Push{"ghij"});
+        test.execute(PopBuffer{7, "cdefghi"});
+        test.execute(BytesPopped{9});
+        test.execute(PopBuffer{7, "j"});
+        test.execute(PopBuffer{7, ""});
+        test.execute(AvailableCapacity{8});
+      }
+    }
+
+    {
+      // A chunked stream hands over the pushed payload without a copy
+      ByteStream stream{100, ByteStream::Storage::chunked};
+      const Buffer payload{"hello"};
+      stream.writer().push(payload, 0, payload.size());
+      stream.writer().push("world");
+      const Buffer popped = stream.reader().pop_buffer(5);
+      if (string_view{popped}.data() != string_view{payload}.data()) {
+        throw runtime_error("pop_buffer() copied a whole chunk");
+      }
+      if (string_view{stream.reader().pop_buffer(3)} != "wor") {
+        throw runtime_error("pop_buffer() of part of a chunk");
+      }
+    }
+  } catch (const exception &e) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -16,8 +16,8 @@ void speed_test(
     const size_t capacity,     // NOLINT(bugprone-easily-swappable-parameters)
     const size_t random_seed,  // NOLINT(bugprone-easily-swappable-parameters)
     const size_t write_size,   // NOLINT(bugprone-easily-swappable-parameters)
-    const size_t read_size)    // NOLINT(bugprone-easily-swappable-parameters)
-{
+    const size_t read_size,    // NOLINT(bugprone-easily-swappable-parameters)
+    const ByteStream::Storage storage) {
   // Generate the data to be written
   const string data = [&random_seed, &input_len] {
     default_random_engine rd{random_seed};
@@ -35,7 +35,7 @@ void speed_test(
     split_data.emplace(data.substr(i, write_size));
   }
 
-  ByteStream bs{capacity};
+  ByteStream bs{capacity, storage};
   string output_data;
   output_data.reserve(data.size());
 
@@ -77,12 +77,16 @@ void speed_test(
   fstream debug_output;
   debug_output.open("/dev/tty");
 
-  cout << "ByteStream with capacity=" << capacity
+  const string storage_name =
+      storage == ByteStream::Storage::chunked ? "chunked" : "ring";
+
+  cout << "ByteStream (" << storage_name << ") with capacity=" << capacity
        << ", write_size=" << write_size << ", read_size=" << read_size
        << " reached " << fixed << setprecision(2) << gigabits_per_second
        << " Gbit/s.\n";
 
-  debug_output << "             ByteStream throughput: " << fixed
+  debug_output << "             ByteStream (" << storage_name
+               << ") throughput: " << fixed
                << setprecision(2) << gigabits_per_second << " Gbit/s\n";
 
   if (gigabits_per_second < 0.05) {
@@ -91,7 +95,18 @@ void speed_test(
   }
 }
 
-void program_body() { speed_test(1e7, 32768, 789, 1500, 128); }
+void program_body() {
+  for (const auto storage :
+       {ByteStream::Storage::ring, ByteStream::Storage::chunked}) {
+    speed_test(1e7, 32768, 789, 1500, 128, storage);
+  }
+
+  // Large writes: the chunked layout moves each write in without copying
+  for (const auto storage :
+       {ByteStream::Storage::ring, ByteStream::Storage::chunked}) {
+    speed_test(1e7, 1 << 20, 789, 1 << 16, 1 << 16, storage);
+  }
+}
 
 int main() {
   try {
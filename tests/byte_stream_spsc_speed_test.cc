@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+
+#include "byte_stream.hh"
+
+using namespace std;
+using namespace std::chrono;
+
+// Wait for the other thread: yield for a while, then sleep, so that a side
+// with nothing to do can't starve the other one of a CPU
+class Backoff {
+  unsigned spins_ = 0;
+
+ public:
+  void wait() {
+    if (++spins_ < 64) {
+      this_thread::yield();
+    } else {
+      this_thread::sleep_for(microseconds{50});
+    }
+  }
+  void reset() { spins_ = 0; }
+};
+
+void speed_test(
+    const size_t input_len,    // NOLINT(bugprone-easily-swappable-parameters)
+    const size_t capacity,     // NOLINT(bugprone-easily-swappable-parameters)
+    const size_t random_seed,  // NOLINT(bugprone-easily-swappable-parameters)
+    const size_t write_size)   // NOLINT(bugprone-easily-swappable-parameters)
+{
+  // Generate the data to be written
+  const string data = [&random_seed, &input_len] {
+    default_random_engine rd{random_seed};
+    uniform_int_distribution<char> ud;
+    string ret;
+    for (size_t i = 0; i < input_len; ++i) {
+      ret += ud(rd);
+    }
+    return ret;
+  }();
+
+  ByteStream bs{capacity, ByteStream::Storage::spsc};
+  string output_data;
+  output_data.reserve(data.size());
+
+  const auto start_time = steady_clock::now();
+
+  // The writer runs on its own thread; the reader stays on this one
+  thread producer{[&] {
+    Writer &writer = bs.writer();
+    Backoff backoff;
+    size_t offset = 0;
+    while (offset < data.size()) {
+      const size_t len =
+          min({write_size, data.size() - offset,
+               static_cast<size_t>(writer.available_capacity())});
+      if (len == 0) {
+        backoff.wait();
+        continue;
+      }
+      backoff.reset();
+      writer.push(data.substr(offset, len));
+      offset += len;
+    }
+    writer.close();
+  }};
+
+  Reader &reader = bs.reader();
+  Backoff backoff;
+  while (not reader.is_finished()) {
+    const auto peeked = reader.peek();
+    if (peeked.empty()) {
+      backoff.wait();
+      continue;
+    }
+    backoff.reset();
+    output_data += peeked;
+    reader.pop(peeked.size());
+  }
+
+  producer.join();
+  const auto stop_time = steady_clock::now();
+
+  if (data != output_data) {
+    throw runtime_error("Mismatch between data written and read");
+  }
+
+  auto test_duration = duration_cast<duration<double>>(stop_time - start_time);
+  auto bytes_per_second =
+      static_cast<double>(input_len) / test_duration.count();
+  auto gigabytes_per_second = bytes_per_second / 1e9;
+
+  fstream debug_output;
+  debug_output.open("/dev/tty");
+
+  cout << "SPSC ByteStream with capacity=" << capacity
+       << ", write_size=" << write_size << " across two threads reached "
+       << fixed << setprecision(2) << gigabytes_per_second << " GB/s.\n";
+
+  debug_output << "             SPSC ByteStream throughput: " << fixed
+               << setprecision(2) << gigabytes_per_second << " GB/s\n";
+
+  if (gigabytes_per_second < 0.01) {
+    throw runtime_error(
+        "SPSC ByteStream did not meet minimum speed of 0.01 GB/s.");
+  }
+}
+
+void program_body() {
+  speed_test(1e7, 32768, 789, 1500);
+  speed_test(1e7, 1 << 20, 789, 1 << 16);
+}
+
+int main() {
+  try {
+    program_body();
+  } catch (const exception &e) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
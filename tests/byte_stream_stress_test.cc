@@ -5,11 +5,24 @@
 
 using namespace std;
 
+string storage_name(ByteStream::Storage storage) {
+  switch (storage) {
+    case ByteStream::Storage::chunked:
+      return ", chunked";
+    case ByteStream::Storage::spsc:
+      return ", spsc";
+    case ByteStream::Storage::pooled:
+      return ", pooled";
+    default:
+      return "";
+  }
+}
+
 void stress_test(
     const size_t input_len,    // NOLINT(bugprone-easily-swappable-parameters)
     const size_t capacity,     // NOLINT(bugprone-easily-swappable-parameters)
-    const size_t random_seed)  // NOLINT(bugprone-easily-swappable-parameters)
-{
+    const size_t random_seed,  // NOLINT(bugprone-easily-swappable-parameters)
+    const ByteStream::Storage storage) {
   default_random_engine rd{random_seed};
 
   const string data = [&rd, &input_len] {
@@ -22,8 +35,9 @@ void stress_test(
   }();
 
   ByteStreamTestHarness bs{"stress test input=" + to_string(input_len) +
-                               ", capacity=" + to_string(capacity),
-                           capacity};
+                               ", capacity=" + to_string(capacity) +
+                               storage_name(storage),
+                           capacity, storage};
 
   size_t expected_bytes_pushed{};
   size_t expected_bytes_popped{};
@@ -77,10 +91,15 @@ void stress_test(
 }
 
 void program_body() {
-  stress_test(19, 3, 10110);
-  stress_test(18, 17, 12345);
-  stress_test(1111, 17, 98765);
-  stress_test(4097, 4096, 11101);
+  for (const auto storage :
+       {ByteStream::Storage::ring, ByteStream::Storage::chunked,
+        ByteStream::Storage::spsc, ByteStream::Storage::pooled}) {
+    stress_test(19, 3, 10110, storage);
+    stress_test(18, 17, 12345, storage);
+    stress_test(1111, 17, 98765, storage);
+    stress_test(4097, 4096, 11101, storage);
+    stress_test(20000, 9000, 31337, storage);
+  }
 }
 
 int main() {
@@ -17,9 +17,11 @@ static_assert(sizeof(Writer) == sizeof(ByteStream),
 
 class ByteStreamTestHarness : public TestHarness<ByteStream> {
  public:
-  ByteStreamTestHarness(std::string test_name, uint64_t capacity)
+  ByteStreamTestHarness(
+      std::string test_name, uint64_t capacity,
+      ByteStream::Storage storage = ByteStream::Storage::ring)
       : TestHarness(move(test_name), "capacity=" + std::to_string(capacity),
-                    ByteStream{capacity}) {}
+                    ByteStream{capacity, storage}) {}
 
   size_t peek_size() { return object().reader().peek().size(); }
 };
@@ -36,6 +38,35 @@ struct Push : public Action<ByteStream> {
   void execute(ByteStream &bs) const override { bs.writer().push(data_); }
 };
 
+struct PushThroughSpans : public Action<ByteStream> {
+  std::string data_;
+
+  explicit PushThroughSpans(std::string data) : data_(move(data)) {}
+  std::string description() const override {
+    return "write \"" + Printer::prettify(data_) +
+           "\" into writable_spans() and commit";
+  }
+  void execute(ByteStream &bs) const override {
+    size_t written = 0;
+    for (const auto span : bs.writer().writable_spans(data_.size())) {
+      written += data_.copy(span.data(), span.size(), written);
+    }
+    bs.writer().commit(written);
+  }
+};
+
+struct SetCapacity : public Action<ByteStream> {
+  uint64_t capacity_;
+
+  explicit SetCapacity(uint64_t capacity) : capacity_(capacity) {}
+  std::string description() const override {
+    return "set capacity to " + std::to_string(capacity_);
+  }
+  void execute(ByteStream &bs) const override {
+    bs.writer().set_capacity(capacity_);
+  }
+};
+
 struct Close : public Action<ByteStream> {
   std::string description() const override { return "close"; }
   void execute(ByteStream &bs) const override { bs.writer().close(); }
@@ -108,6 +139,51 @@ struct PeekOnce : public Peek {
   }
 };
 
+struct PeekSpans : public Peek {
+  using Peek::Peek;
+
+  std::string description() const override {
+    return "peek_spans() cover \"" + Printer::prettify(output_) + "\"";
+  }
+
+  void execute(ByteStream &bs) const override {
+    std::string got;
+    for (const auto span : bs.reader().peek_spans()) {
+      if (span.empty()) {
+        throw ExpectationViolation{"Reader::peek_spans() returned empty span"};
+      }
+      got += span;
+    }
+    if (got != output_) {
+      throw ExpectationViolation{"Expected \"" + Printer::prettify(output_) +
+                                 "\" in spans, " + " but found \"" +
+                                 Printer::prettify(got) + "\""};
+    }
+  }
+};
+
+struct PopBuffer : public Expectation<ByteStream> {
+  size_t len_;
+  std::string output_;
+
+  PopBuffer(size_t len, std::string output)
+      : len_(len), output_(move(output)) {}
+
+  std::string description() const override {
+    return "pop_buffer( " + std::to_string(len_) + " ) gives \"" +
+           Printer::prettify(output_) + "\"";
+  }
+
+  void execute(ByteStream &bs) const override {
+    const Buffer got = bs.reader().pop_buffer(len_);
+    if (std::string_view{got} != output_) {
+      throw ExpectationViolation{"Expected \"" + Printer::prettify(output_) +
+                                 "\" from pop_buffer(), but found \"" +
+                                 Printer::prettify(got) + "\""};
+    }
+  }
+};
+
 struct IsClosed : public ExpectBool<ByteStream> {
   using ExpectBool::ExpectBool;
   std::string name() const override { return "is_closed"; }
@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "byte_stream.hh"
+#include "congestion_control.hh"
+#include "reassembler.hh"
+#include "tcp_config.hh"
+#include "tcp_receiver.hh"
+#include "tcp_sender.hh"
+
+using namespace std;
+
+namespace {
+
+// A 10 Mbit/s bottleneck with a 40 ms round trip, in front of a drop-tail
+// buffer ten bandwidth-delay products deep: a loss-based sender has to fill
+// all of it, 400 ms of queueing, before it sees a loss. Reno's slow start
+// then overshoots by about a window, and without SACK it repairs most of
+// those losses by going back to the first after a retransmission timeout.
+constexpr uint64_t kRate = 1250;  // bytes per ms
+constexpr uint64_t kOneWayMs = 20;
+constexpr uint64_t kBDP = kRate * 2 * kOneWayMs;
+constexpr uint64_t kBufferBytes = 10 * kBDP;
+constexpr uint64_t kDurationMs = 30'000;
+
+struct Result {
+  double goodput;  // fraction of the bottleneck's rate delivered in order
+  double mean_rtt_ms;
+  uint64_t peak_queue;
+  uint64_t drops;
+};
+
+// Run a bulk transfer through the bottleneck, a millisecond at a time
+template <typename CC>
+Result simulate(const string &name) {
+  ByteStream source{1'000'000};
+  BasicTCPSender<CC> sender{TCPConfig::TIMEOUT_DFLT, Wrap32{0}};
+  ByteStream sink{4'000'000};
+  Reassembler reassembler;
+  TCPReceiver receiver;
+
+  deque<TCPSenderMessage> queue;  // waiting at the bottleneck
+  uint64_t queue_bytes = 0;
+  uint64_t credit = 0;  // bytes the bottleneck may still send this ms
+  deque<pair<uint64_t, TCPSenderMessage>> to_receiver;  // (arrival, segment)
+  deque<pair<uint64_t, TCPReceiverMessage>> to_sender;  // (arrival, ACK)
+
+  Result result{};
+  uint64_t rtt_sum = 0;
+  uint64_t rtt_samples = 0;
+
+  for (uint64_t now = 0; now < kDurationMs; ++now) {
+    while (not to_sender.empty() and to_sender.front().first <= now) {
+      sender.receive(to_sender.front().second);
+      to_sender.pop_front();
+      if (const auto rtt = sender.rtt_sample_ms()) {
+        rtt_sum += *rtt;
+        ++rtt_samples;
+      }
+    }
+
+    // The application always has more to send
+    source.writer().push(string(source.writer().available_capacity(), 'x'));
+    sender.push(source.reader());
+    while (auto msg = sender.maybe_send()) {
+      const uint64_t size = msg->sequence_length();
+      if (queue_bytes + size > kBufferBytes) {
+        ++result.drops;
+        continue;
+      }
+      queue_bytes += size;
+      queue.push_back(move(*msg));
+    }
+    result.peak_queue = max(result.peak_queue, queue_bytes);
+
+    credit += kRate;
+    while (not queue.empty() and credit >= queue.front().sequence_length()) {
+      credit -= queue.front().sequence_length();
+      queue_bytes -= queue.front().sequence_length();
+      to_receiver.emplace_back(now + kOneWayMs, move(queue.front()));
+      queue.pop_front();
+    }
+    if (queue.empty()) {
+      credit = 0;  // an idle link saves nothing up
+    }
+
+    while (not to_receiver.empty() and to_receiver.front().first <= now) {
+      receiver.receive(to_receiver.front().second, reassembler,
+                       sink.writer());
+      to_receiver.pop_front();
+      sink.reader().pop(sink.reader().bytes_buffered());
+      if (auto ack = receiver.maybe_send(sink.writer())) {
+        to_sender.emplace_back(now + kOneWayMs, move(*ack));
+      }
+    }
+
+    sender.tick(1);
+    receiver.tick(1);
+  }
+
+  result.goodput = static_cast<double>(sink.reader().bytes_popped()) /
+                   static_cast<double>(kRate * kDurationMs);
+  result.mean_rtt_ms = rtt_samples == 0 ? 0
+                                        : static_cast<double>(rtt_sum) /
+                                              static_cast<double>(rtt_samples);
+
+  fstream debug_output;
+  debug_output.open("/dev/tty");
+
+  cout << name << " through a " << kBufferBytes / kBDP
+       << " BDP buffer: " << fixed << setprecision(1)
+       << 100 * result.goodput << "% of the bottleneck, mean RTT "
+       << result.mean_rtt_ms << " ms, peak queue " << result.peak_queue
+       << " bytes, " << result.drops << " drops.\n";
+  debug_output << "             " << left << setw(6) << name << right
+               << " goodput " << setw(5) << fixed << setprecision(1)
+               << 100 * result.goodput << "%  mean RTT " << setw(6)
+               << result.mean_rtt_ms << " ms  peak queue " << setw(7)
+               << result.peak_queue << "  drops " << setw(5) << result.drops
+               << "\n";
+  return result;
+}
+
+}  // namespace
+
+void program_body() {
+  const Result reno = simulate<Reno>("Reno");
+  const Result bbr = simulate<BBR>("BBR");
+
+  // BBR should keep the link busy without standing in the queue
+  if (bbr.goodput < 0.9) {
+    throw runtime_error("BBR used less than 90% of the bottleneck.");
+  }
+  if (bbr.mean_rtt_ms > 3 * 2 * kOneWayMs) {
+    throw runtime_error("BBR's mean RTT was more than 3x the path's.");
+  }
+  if (bbr.mean_rtt_ms >= reno.mean_rtt_ms) {
+    throw runtime_error("BBR queued no less than Reno.");
+  }
+}
+
+int main() {
+  try {
+    program_body();
+  } catch (const exception &e) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
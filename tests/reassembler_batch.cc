@@ -0,0 +1,150 @@
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "reassembler_test_harness.hh"
+
+using namespace std;
+
+// Deliver the stream in bursts of shuffled, overlapping segments, once through
+// insert_batch and once through insert in sorted order, and check that both
+// agree on the output and bytes_pending() after every burst
+void random_test(
+    const Reassembler::Engine engine,
+    const size_t input_len,    // NOLINT(bugprone-easily-swappable-parameters)
+    const size_t capacity,     // NOLINT(bugprone-easily-swappable-parameters)
+    const size_t random_seed)  // NOLINT(bugprone-easily-swappable-parameters)
+{
+  default_random_engine rd{random_seed};
+
+  const string data = [&rd, &input_len] {
+    uniform_int_distribution<char> ud;
+    string ret;
+    for (size_t i = 0; i < input_len; ++i) {
+      ret += ud(rd);
+    }
+    return ret;
+  }();
+
+  ByteStream batch_stream{capacity}, single_stream{capacity};
+  Reassembler batch_reassembler{engine}, single_reassembler{engine};
+  string batch_output, single_output;
+
+  const auto test_name = "engine=" + to_string(static_cast<int>(engine)) +
+                         ", input=" + to_string(input_len) +
+                         ", capacity=" + to_string(capacity) +
+                         ", seed=" + to_string(random_seed);
+
+  uniform_int_distribution<size_t> burst_dist{1, 64};
+  uniform_int_distribution<size_t> len_dist{0, capacity / 8 + 1};
+  for (size_t burst = 0; not batch_stream.reader().is_finished(); ++burst) {
+    if (burst > 100 * input_len + 1000) {
+      throw runtime_error(test_name + ": stream never finished");
+    }
+
+    const uint64_t next = batch_stream.writer().bytes_pushed();
+    uniform_int_distribution<uint64_t> index_dist{next, next + capacity};
+    vector<Reassembler::Substring> batch;
+    for (size_t i = burst_dist(rd); i > 0; --i) {
+      const uint64_t first_index = min<uint64_t>(index_dist(rd), input_len);
+      const size_t len = min(len_dist(rd), input_len - first_index);
+      batch.push_back(Reassembler::Substring{
+          first_index, Buffer{data.substr(first_index, len)}, 0, len,
+          first_index + len == input_len});
+    }
+
+    batch_reassembler.insert_batch(batch, batch_stream.writer());
+    stable_sort(batch.begin(), batch.end(), [](const auto &a, const auto &b) {
+      return a.first_index < b.first_index;
+    });
+    for (const auto &substring : batch) {
+      single_reassembler.insert(substring.first_index, substring.payload, 0,
+                                substring.length, substring.is_last_substring,
+                                single_stream.writer());
+    }
+
+    if (batch_reassembler.bytes_pending() !=
+            single_reassembler.bytes_pending() or
+        batch_stream.writer().bytes_pushed() !=
+            single_stream.writer().bytes_pushed() or
+        batch_stream.writer().is_closed() !=
+            single_stream.writer().is_closed()) {
+      throw runtime_error(test_name +
+                          ": insert_batch disagrees with insert at burst " +
+                          to_string(burst));
+    }
+
+    string out;
+    read(batch_stream.reader(), batch_stream.reader().bytes_buffered(), out);
+    batch_output += out;
+    read(single_stream.reader(), single_stream.reader().bytes_buffered(), out);
+    single_output += out;
+  }
+
+  if (batch_output != data or single_output != data) {
+    throw runtime_error(test_name + ": did not reassemble the stream");
+  }
+}
+
+void program_body() {
+  for (const auto engine :
+       {Reassembler::Engine::segment_map, Reassembler::Engine::byte_ring,
+        Reassembler::Engine::interval_set}) {
+    {
+      ReassemblerTestHarness test{"batch out of order", 65000,
+                                  Reassembler{engine}};
+      test.execute(InsertBatch{{Insert{"def", 3}, Insert{"ghi", 6}.is_last(),
+                                Insert{"abc", 0}}});
+      test.execute(BytesPushed{9});
+      test.execute(BytesPending{0});
+      test.execute(ReadAll{"abcdefghi"});
+      test.execute(IsFinished{true});
+    }
+
+    {
+      ReassemblerTestHarness test{"batch with a hole", 65000,
+                                  Reassembler{engine}};
+      test.execute(InsertBatch{
+          {Insert{"ghi", 6}, Insert{"ab", 0}, Insert{"bcd", 1}}});
+      test.execute(BytesPushed{4});
+      test.execute(BytesPending{3});
+      test.execute(InsertBatch{{Insert{"ef", 4}}});
+      test.execute(BytesPushed{9});
+      test.execute(BytesPending{0});
+      test.execute(ReadAll{"abcdefghi"});
+    }
+
+    {
+      ReassemblerTestHarness test{"batch past capacity", 4,
+                                  Reassembler{engine}};
+      test.execute(InsertBatch{
+          {Insert{"efgh", 4}, Insert{"abcd", 0}, Insert{"cdef", 2}}});
+      test.execute(BytesPushed{4});
+      test.execute(BytesPending{0});
+      test.execute(ReadAll{"abcd"});
+      test.execute(InsertBatch{{Insert{"efgh", 4}.is_last()}});
+      test.execute(ReadAll{"efgh"});
+      test.execute(IsFinished{true});
+    }
+
+    random_test(engine, 1000, 64, 1);
+    random_test(engine, 20000, 1000, 2);
+    random_test(engine, 20000, 65000, 3);
+  }
+}
+
+int main() {
+  try {
+    program_body();
+  } catch (const exception &e) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
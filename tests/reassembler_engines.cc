@@ -0,0 +1,169 @@
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "reassembler.hh"
+
+using namespace std;
+
+// Feed every engine the same random mix of out-of-order, overlapping and
+// out-of-window substrings, and check that each reassembles the original
+// stream and agrees on bytes_pending() at every step
+void random_test(
+    const size_t input_len,    // NOLINT(bugprone-easily-swappable-parameters)
+    const size_t capacity,     // NOLINT(bugprone-easily-swappable-parameters)
+    const size_t random_seed)  // NOLINT(bugprone-easily-swappable-parameters)
+{
+  default_random_engine rd{random_seed};
+
+  const string data = [&rd, &input_len] {
+    uniform_int_distribution<char> ud;
+    string ret;
+    for (size_t i = 0; i < input_len; ++i) {
+      ret += ud(rd);
+    }
+    return ret;
+  }();
+
+  const vector<Reassembler::Engine> engines{Reassembler::Engine::segment_map,
+                                            Reassembler::Engine::byte_ring,
+                                            Reassembler::Engine::interval_set};
+  vector<ByteStream> streams(engines.size(), ByteStream{capacity});
+  vector<Reassembler> reassemblers;
+  vector<string> outputs(engines.size());
+  for (const auto engine : engines) {
+    reassemblers.emplace_back(engine);
+  }
+
+  const auto test_name = "input=" + to_string(input_len) +
+                         ", capacity=" + to_string(capacity) +
+                         ", seed=" + to_string(random_seed);
+
+  uniform_int_distribution<size_t> len_dist{0, capacity / 2 + 1};
+  for (size_t step = 0; not streams.front().reader().is_finished(); ++step) {
+    if (step > 100 * input_len + 1000) {
+      throw runtime_error(test_name + ": stream never finished");
+    }
+
+    // Mostly near the next needed byte, sometimes past the window
+    const uint64_t next = streams.front().writer().bytes_pushed();
+    uniform_int_distribution<uint64_t> index_dist{
+        next > capacity ? next - capacity : 0, next + capacity + capacity / 4};
+    const uint64_t first_index = min<uint64_t>(index_dist(rd), input_len);
+    const size_t len = min(len_dist(rd), input_len - first_index);
+    const bool is_last = first_index + len == input_len;
+
+    // Every other step, insert a slice of a larger shared payload instead
+    const uint64_t pad = step % 2 ? min<uint64_t>(first_index, 3) : 0;
+    const Buffer payload{data.substr(first_index - pad, len + 2 * pad)};
+    for (size_t i = 0; i < engines.size(); ++i) {
+      if (step % 2) {
+        reassemblers[i].insert(first_index, payload, pad, len, is_last,
+                               streams[i].writer());
+      } else {
+        reassemblers[i].insert(first_index, data.substr(first_index, len),
+                               is_last, streams[i].writer());
+      }
+    }
+
+    // Read a random amount from each stream
+    const uint64_t to_read = uniform_int_distribution<uint64_t>{
+        0, streams.front().reader().bytes_buffered()}(rd);
+    for (size_t i = 0; i < engines.size(); ++i) {
+      string out;
+      read(streams[i].reader(), to_read, out);
+      outputs[i] += out;
+
+      if (reassemblers[i].bytes_pending() !=
+              reassemblers.front().bytes_pending() or
+          streams[i].writer().bytes_pushed() !=
+              streams.front().writer().bytes_pushed()) {
+        throw runtime_error(test_name + ": engine " + to_string(i) +
+                            " disagrees with engine 0 at step " +
+                            to_string(step));
+      }
+    }
+  }
+
+  for (size_t i = 0; i < engines.size(); ++i) {
+    if (not streams[i].reader().is_finished() or outputs[i] != data) {
+      throw runtime_error(test_name + ": engine " + to_string(i) +
+                          " did not reassemble the stream");
+    }
+  }
+}
+
+// Bytes held past the stream's capacity, after it shrinks, wait in the
+// Reassembler until the capacity grows again
+void shrunk_capacity_test() {
+  for (const auto engine : {Reassembler::Engine::segment_map,
+                            Reassembler::Engine::byte_ring,
+                            Reassembler::Engine::interval_set}) {
+    ByteStream stream{10};
+    Reassembler reassembler{engine};
+    reassembler.insert(1, "bcd", false, stream.writer());
+    stream.writer().set_capacity(2);
+    reassembler.insert(0, "a", false, stream.writer());
+    stream.writer().set_capacity(10);
+    reassembler.insert(4, "efgh", true, stream.writer());
+
+    string out;
+    read(stream.reader(), stream.reader().bytes_buffered(), out);
+    if (out != "abcdefgh" or not stream.reader().is_finished()) {
+      throw runtime_error("engine " + to_string(static_cast<int>(engine)) +
+                          " read \"" + out + "\" after the capacity shrank");
+    }
+  }
+}
+
+// A duplicate leaves the bytes already held alone, even if it disagrees
+// with them (the byte_ring engine, which overwrites in place, is exempt)
+void duplicate_test() {
+  for (const auto engine : {Reassembler::Engine::segment_map,
+                            Reassembler::Engine::interval_set}) {
+    ByteStream stream{10};
+    Reassembler reassembler{engine};
+    reassembler.insert(1, "bcd", false, stream.writer());
+    reassembler.insert(2, "xy", false, stream.writer());
+    reassembler.insert(1, "bc", false, stream.writer());
+    reassembler.insert(4, "ef", false, stream.writer());
+    if (reassembler.bytes_pending() != 5) {
+      throw runtime_error("engine " + to_string(static_cast<int>(engine)) +
+                          " counted duplicate bytes as pending");
+    }
+    reassembler.insert(0, "a", false, stream.writer());
+
+    string out;
+    read(stream.reader(), stream.reader().bytes_buffered(), out);
+    if (out != "abcdef") {
+      throw runtime_error("engine " + to_string(static_cast<int>(engine)) +
+                          " read \"" + out + "\" instead of \"abcdef\"");
+    }
+  }
+}
+
+void program_body() {
+  shrunk_capacity_test();
+  duplicate_test();
+  random_test(100, 8, 1);
+  random_test(1000, 17, 2);
+  random_test(5000, 64, 3);
+  random_test(5000, 200, 4);
+  random_test(20000, 1000, 5);
+}
+
+int main() {
+  try {
+    program_body();
+  } catch (const exception &e) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
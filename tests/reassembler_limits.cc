@@ -0,0 +1,97 @@
+#include <exception>
+#include <iostream>
+
+#include "reassembler_test_harness.hh"
+
+using namespace std;
+
+int main() {
+  try {
+    for (const auto engine : {Reassembler::Engine::segment_map,
+                              Reassembler::Engine::interval_set}) {
+      {
+        ReassemblerTestHarness test{"every other byte", 65000,
+                                    Reassembler{engine, {4, UINT64_MAX}}};
+
+        // One-byte pieces with a hole between each pair
+        for (uint64_t i = 1; i < 20; i += 2) {
+          test.execute(Insert{string(1, static_cast<char>('a' + i)), i});
+        }
+        test.execute(BytesPending{4});
+        test.execute(EvictedIntervals{6});
+        test.execute(EvictedBytes{6});
+
+        // The pieces closest to the next needed byte were kept
+        test.execute(Insert{"a", 0});
+        test.execute(BytesPushed(2));
+        test.execute(Insert{"c", 2});
+        test.execute(Insert{"e", 4});
+        test.execute(Insert{"g", 6});
+        test.execute(BytesPushed(8));
+        test.execute(BytesPending{0});
+        test.execute(ReadAll("abcdefgh"));
+      }
+
+      {
+        ReassemblerTestHarness test{"merged pieces count once", 65000,
+                                    Reassembler{engine, {2, UINT64_MAX}}};
+
+        test.execute(Insert{"bc", 1});
+        test.execute(Insert{"de", 3});
+        test.execute(Insert{"gh", 6});
+        test.execute(Insert{"jk", 9});
+        test.execute(EvictedBytes{2});
+        test.execute(BytesPending{6});
+
+        test.execute(Insert{"a", 0});
+        test.execute(Insert{"f", 5});
+        test.execute(Insert{"i", 8}.is_last());
+        test.execute(ReadAll("abcdefghi"));
+        test.execute(IsFinished{true});
+      }
+
+      {
+        ReassemblerTestHarness test{"overhead limit", 65000,
+                                    Reassembler{engine, {UINT64_MAX, 0}}};
+
+        test.execute(Insert{"b", 1});
+        test.execute(BytesPending{0});
+        test.execute(EvictedIntervals{1});
+
+        test.execute(Insert{"ab", 0});
+        test.execute(ReadAll("ab"));
+      }
+    }
+
+    {
+      ReassemblerTestHarness test{
+          "small slices don't pin their segment", 65000,
+          Reassembler{Reassembler::Engine::interval_set}};
+
+      // Resends of mostly held bytes, each filling in one byte or two
+      test.execute(Insert{string(998, 'b'), 2});
+      test.execute(Insert{"a" + string(998, 'b') + "c", 1});
+      test.execute(BytesPending{1000});
+      test.execute(BytesRetained{1000});
+      test.execute(Insert{string(999, 'b') + "cd", 1});
+      test.execute(BytesPending{1001});
+      test.execute(BytesRetained{1001});
+
+      // Gaps that make up most of a segment still share it
+      test.execute(Insert{string(100, 'x'), 2000});
+      test.execute(Insert{string(1000, 'x'), 1900});
+      test.execute(BytesPending{2001});
+      test.execute(BytesRetained{2101});
+
+      test.execute(Insert{"a", 0});
+      test.execute(Insert{string(898, 'y'), 1002});
+      test.execute(BytesPending{0});
+      test.execute(BytesPushed{2900});
+    }
+  } catch (const exception &e) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
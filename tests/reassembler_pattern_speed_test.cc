@@ -0,0 +1,240 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "reassembler.hh"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+constexpr uint64_t kCapacity = 64000;
+constexpr uint64_t kMSS = 1460;
+constexpr uint64_t kStreamLen = 16'000'000;
+
+struct Segment {
+  uint64_t first_index;
+  uint64_t length;
+};
+
+// Split [begin, end) into segments of at most `size` bytes
+void split(vector<Segment> &out, uint64_t begin, uint64_t end, uint64_t size) {
+  for (uint64_t i = begin; i < end; i += size) {
+    out.push_back(Segment{i, min(size, end - i)});
+  }
+}
+
+// Each pattern delivers the whole stream one window (kCapacity bytes) at a
+// time, so every segment is inside the window when it arrives as long as the
+// reader keeps draining the stream
+struct Pattern {
+  string name;
+  uint64_t stream_len;
+  vector<Segment> (*generate)(uint64_t stream_len, default_random_engine &rd);
+};
+
+const vector<Pattern> patterns{
+    {"in-order MSS", kStreamLen,
+     [](uint64_t stream_len, default_random_engine &) {
+       vector<Segment> segments;
+       split(segments, 0, stream_len, kMSS);
+       return segments;
+     }},
+    {"random reorder", kStreamLen,
+     [](uint64_t stream_len, default_random_engine &rd) {
+       vector<Segment> segments;
+       for (uint64_t window = 0; window < stream_len; window += kCapacity) {
+         const auto begin = segments.size();
+         split(segments, window, min(window + kCapacity, stream_len), kMSS);
+         shuffle(segments.begin() + static_cast<ptrdiff_t>(begin),
+                 segments.end(), rd);
+       }
+       return segments;
+     }},
+    {"reverse", kStreamLen,
+     [](uint64_t stream_len, default_random_engine &) {
+       vector<Segment> segments;
+       for (uint64_t window = 0; window < stream_len; window += kCapacity) {
+         const auto begin = segments.size();
+         split(segments, window, min(window + kCapacity, stream_len), kMSS);
+         reverse(segments.begin() + static_cast<ptrdiff_t>(begin),
+                 segments.end());
+       }
+       return segments;
+     }},
+    {"1-byte", 256'000,
+     [](uint64_t stream_len, default_random_engine &rd) {
+       // Mostly in order, shuffled within runs of 16 bytes
+       vector<Segment> segments;
+       split(segments, 0, stream_len, 1);
+       for (size_t i = 0; i < segments.size(); i += 16) {
+         shuffle(segments.begin() + static_cast<ptrdiff_t>(i),
+                 segments.begin() +
+                     static_cast<ptrdiff_t>(min(i + 16, segments.size())),
+                 rd);
+       }
+       return segments;
+     }},
+    {"heavy duplication", kStreamLen,
+     [](uint64_t stream_len, default_random_engine &rd) {
+       // Every segment four times, the copies delayed and shifted by a few
+       // bytes, as from spurious retransmissions
+       vector<Segment> segments;
+       vector<Segment> originals;
+       split(originals, 0, stream_len, kMSS);
+       uniform_int_distribution<uint64_t> shift{0, 8};
+       for (size_t i = 0; i < originals.size(); ++i) {
+         segments.push_back(originals[i]);
+         for (size_t back = 1; back <= 3 and back <= i; ++back) {
+           const Segment &dup = originals[i - back];
+           const uint64_t s = min(shift(rd), dup.length);
+           segments.push_back(Segment{dup.first_index + s, dup.length - s});
+         }
+       }
+       return segments;
+     }},
+    {"SACK holes", kStreamLen,
+     [](uint64_t stream_len, default_random_engine &) {
+       // Lose every fourth segment of each window, then fill the holes
+       // last to first, as a sender repairing from SACK blocks might
+       vector<Segment> segments;
+       for (uint64_t window = 0; window < stream_len; window += kCapacity) {
+         vector<Segment> window_segments;
+         split(window_segments, window, min(window + kCapacity, stream_len),
+               kMSS);
+         vector<Segment> holes;
+         for (size_t i = 0; i < window_segments.size(); ++i) {
+           (i % 4 == 0 ? holes : segments).push_back(window_segments[i]);
+         }
+         segments.insert(segments.end(), holes.rbegin(), holes.rend());
+       }
+       return segments;
+     }},
+};
+
+string engine_name(Reassembler::Engine engine) {
+  switch (engine) {
+    case Reassembler::Engine::segment_map:
+      return "segment_map";
+    case Reassembler::Engine::byte_ring:
+      return "byte_ring";
+    default:
+      return "interval_set";
+  }
+}
+
+void speed_test(const Pattern &pattern, const Reassembler::Engine engine,
+                const size_t random_seed) {
+  default_random_engine rd{random_seed};
+
+  // Generate the data to be written, as one payload the segments slice
+  const Buffer data = [&] {
+    uniform_int_distribution<char> ud;
+    string ret;
+    for (size_t i = 0; i < pattern.stream_len; ++i) {
+      ret += ud(rd);
+    }
+    return Buffer{move(ret)};
+  }();
+  const vector<Segment> segments = pattern.generate(pattern.stream_len, rd);
+
+  ByteStream stream{kCapacity};
+  Reassembler reassembler{engine};
+
+  string output_data;
+  output_data.reserve(pattern.stream_len);
+  vector<uint64_t> insert_ns;
+  insert_ns.reserve(segments.size());
+  uint64_t peak_pending = 0;
+
+  for (const Segment &segment : segments) {
+    const auto start_time = steady_clock::now();
+    reassembler.insert(segment.first_index, data, segment.first_index,
+                       segment.length,
+                       segment.first_index + segment.length ==
+                           pattern.stream_len,
+                       stream.writer());
+    const auto stop_time = steady_clock::now();
+    insert_ns.push_back(
+        duration_cast<nanoseconds>(stop_time - start_time).count());
+    peak_pending = max(peak_pending, reassembler.bytes_pending());
+
+    while (stream.reader().bytes_buffered()) {
+      output_data += stream.reader().peek();
+      stream.reader().pop(output_data.size() - stream.reader().bytes_popped());
+    }
+  }
+
+  if (not stream.reader().is_finished()) {
+    throw runtime_error("Reassembler did not close ByteStream when finished");
+  }
+
+  if (string_view{data} != output_data) {
+    throw runtime_error("Mismatch between data written and read");
+  }
+
+  uint64_t total_ns = 0;
+  for (const uint64_t ns : insert_ns) {
+    total_ns += ns;
+  }
+  sort(insert_ns.begin(), insert_ns.end());
+  const auto percentile = [&insert_ns](double p) {
+    return insert_ns[min(insert_ns.size() - 1,
+                         static_cast<size_t>(p * insert_ns.size()))];
+  };
+  const double gigabits_per_second =
+      8.0 * static_cast<double>(pattern.stream_len) /
+      static_cast<double>(max(total_ns, uint64_t{1}));
+
+  fstream debug_output;
+  debug_output.open("/dev/tty");
+
+  cout << "Reassembler (" << engine_name(engine) << ") " << pattern.name
+       << ": " << insert_ns.size() << " inserts, ns/insert p50="
+       << percentile(0.5) << " p99=" << percentile(0.99)
+       << " p999=" << percentile(0.999)
+       << ", peak bytes_pending=" << peak_pending << ", " << fixed
+       << setprecision(2) << gigabits_per_second << " Gbit/s.\n";
+
+  debug_output << "             " << left << setw(13) << engine_name(engine)
+               << setw(18) << pattern.name << right << " p50 " << setw(7)
+               << percentile(0.5) << " ns  p99 " << setw(7)
+               << percentile(0.99) << " ns  p999 " << setw(8)
+               << percentile(0.999) << " ns  peak pending " << setw(6)
+               << peak_pending << "\n";
+
+  if (percentile(0.5) > 100'000) {
+    throw runtime_error(
+        "Reassembler did not meet maximum median insert time of 100 us.");
+  }
+}
+
+}  // namespace
+
+void program_body() {
+  for (const Pattern &pattern : patterns) {
+    for (const auto engine :
+         {Reassembler::Engine::segment_map, Reassembler::Engine::byte_ring,
+          Reassembler::Engine::interval_set}) {
+      speed_test(pattern, engine, 1370);
+    }
+  }
+}
+
+int main() {
+  try {
+    program_body();
+  } catch (const exception &e) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
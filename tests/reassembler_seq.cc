@@ -21,6 +21,27 @@ int main() {
       test.execute(IsFinished{false});
     }
 
+    {
+      ReassemblerTestHarness test{"seq fast path", 65000};
+
+      test.execute(Insert{"abcd", 0});
+      test.execute(Insert{"efgh", 4});
+      test.execute(FastPathHits{2});
+      test.execute(SlowPathHits{0});
+
+      test.execute(Insert{"mnop", 12});
+      test.execute(Insert{"ijkl", 8});
+      test.execute(FastPathHits{2});
+      test.execute(SlowPathHits{2});
+      test.execute(BytesPending{0});
+
+      test.execute(Insert{"qrst", 16}.is_last());
+      test.execute(FastPathHits{3});
+      test.execute(BytesPushed(20));
+      test.execute(ReadAll("abcdefghijklmnopqrst"));
+      test.execute(IsFinished{true});
+    }
+
     {
       ReassemblerTestHarness test{"seq 2", 65000};
 
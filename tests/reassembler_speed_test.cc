@@ -16,8 +16,8 @@ using namespace std::chrono;
 void speed_test(
     const size_t num_chunks,   // NOLINT(bugprone-easily-swappable-parameters)
     const size_t capacity,     // NOLINT(bugprone-easily-swappable-parameters)
-    const size_t random_seed)  // NOLINT(bugprone-easily-swappable-parameters)
-{
+    const size_t random_seed,  // NOLINT(bugprone-easily-swappable-parameters)
+    const Reassembler::Engine engine) {
   // Generate the data to be written
   const string data = [&] {
     default_random_engine rd{random_seed};
@@ -41,7 +41,7 @@ void speed_test(
   }
 
   ByteStream stream{capacity};
-  Reassembler reassembler;
+  Reassembler reassembler{engine};
 
   string output_data;
   output_data.reserve(data.size());
@@ -78,10 +78,23 @@ void speed_test(
   fstream debug_output;
   debug_output.open("/dev/tty");
 
-  cout << "Reassembler to ByteStream with capacity=" << capacity << " reached "
-       << fixed << setprecision(2) << gigabits_per_second << " Gbit/s.\n";
+  const string engine_name = [&engine] {
+    switch (engine) {
+      case Reassembler::Engine::segment_map:
+        return "segment_map";
+      case Reassembler::Engine::byte_ring:
+        return "byte_ring";
+      default:
+        return "interval_set";
+    }
+  }();
+
+  cout << "Reassembler (" << engine_name
+       << ") to ByteStream with capacity=" << capacity << " reached " << fixed
+       << setprecision(2) << gigabits_per_second << " Gbit/s.\n";
 
-  debug_output << "             Reassembler throughput: " << fixed
+  debug_output << "             Reassembler (" << engine_name
+               << ") throughput: " << fixed
                << setprecision(2) << gigabits_per_second << " Gbit/s\n";
 
   if (gigabits_per_second < 0.1) {
@@ -90,7 +103,13 @@ void speed_test(
   }
 }
 
-void program_body() { speed_test(10000, 1500, 1370); }
+void program_body() {
+  for (const auto engine :
+       {Reassembler::Engine::segment_map, Reassembler::Engine::byte_ring,
+        Reassembler::Engine::interval_set}) {
+    speed_test(10000, 1500, 1370, engine);
+  }
+}
 
 int main() {
   try {
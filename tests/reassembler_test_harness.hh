@@ -3,6 +3,7 @@
 #include <optional>
 #include <sstream>
 #include <utility>
+#include <vector>
 
 #include "byte_stream_test_harness.hh"
 #include "common.hh"
@@ -28,9 +29,10 @@ struct ReassemblerByteStreamTestStep : public TestStep<StreamAndReassembler> {
 
 class ReassemblerTestHarness : public TestHarness<StreamAndReassembler> {
  public:
-  ReassemblerTestHarness(std::string test_name, uint64_t capacity)
+  ReassemblerTestHarness(std::string test_name, uint64_t capacity,
+                         Reassembler reassembler = Reassembler{})
       : TestHarness(move(test_name), "capacity=" + std::to_string(capacity),
-                    {ByteStream{capacity}, Reassembler{}}) {}
+                    {ByteStream{capacity}, std::move(reassembler)}) {}
 
   template <std::derived_from<TestStep<ByteStream>> T>
   void execute(const T &test) {
@@ -49,6 +51,47 @@ struct BytesPending : public ExpectNumber<StreamAndReassembler, uint64_t> {
   }
 };
 
+struct FastPathHits : public ExpectNumber<StreamAndReassembler, uint64_t> {
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "fast_path_hits"; }
+  uint64_t value(StreamAndReassembler &sr) const override {
+    return sr.second.fast_path_hits();
+  }
+};
+
+struct SlowPathHits : public ExpectNumber<StreamAndReassembler, uint64_t> {
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "slow_path_hits"; }
+  uint64_t value(StreamAndReassembler &sr) const override {
+    return sr.second.slow_path_hits();
+  }
+};
+
+struct EvictedIntervals
+    : public ExpectNumber<StreamAndReassembler, uint64_t> {
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "evicted_intervals"; }
+  uint64_t value(StreamAndReassembler &sr) const override {
+    return sr.second.evicted_intervals();
+  }
+};
+
+struct EvictedBytes : public ExpectNumber<StreamAndReassembler, uint64_t> {
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "evicted_bytes"; }
+  uint64_t value(StreamAndReassembler &sr) const override {
+    return sr.second.evicted_bytes();
+  }
+};
+
+struct BytesRetained : public ExpectNumber<StreamAndReassembler, uint64_t> {
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "bytes_retained"; }
+  uint64_t value(StreamAndReassembler &sr) const override {
+    return sr.second.bytes_retained();
+  }
+};
+
 struct Insert : public Action<StreamAndReassembler> {
   std::string data_;
   uint64_t first_index_;
@@ -77,3 +120,28 @@ struct Insert : public Action<StreamAndReassembler> {
                      sr.first.writer());
   }
 };
+
+struct InsertBatch : public Action<StreamAndReassembler> {
+  std::vector<Insert> inserts_;
+
+  explicit InsertBatch(std::vector<Insert> inserts)
+      : inserts_(std::move(inserts)) {}
+
+  std::string description() const override {
+    std::string ret = "insert batch {";
+    for (const auto &insert : inserts_) {
+      ret += " " + insert.description() + ";";
+    }
+    return ret + " }";
+  }
+
+  void execute(StreamAndReassembler &sr) const override {
+    std::vector<Reassembler::Substring> batch;
+    for (const auto &insert : inserts_) {
+      batch.push_back(Reassembler::Substring{
+          insert.first_index_, Buffer{insert.data_}, 0, insert.data_.size(),
+          insert.is_last_substring_});
+    }
+    sr.second.insert_batch(batch, sr.first.writer());
+  }
+};
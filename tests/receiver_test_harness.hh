@@ -3,6 +3,7 @@
 #include <optional>
 #include <sstream>
 #include <utility>
+#include <vector>
 
 #include "common.hh"
 #include "reassembler_test_harness.hh"
@@ -26,9 +27,12 @@ struct ReceiverSetTestStep : public TestStep<ReceiverSet> {
 
 class TCPReceiverTestHarness : public TestHarness<ReceiverSet> {
  public:
-  TCPReceiverTestHarness(std::string test_name, uint64_t capacity)
+  TCPReceiverTestHarness(std::string test_name, uint64_t capacity,
+                         Reassembler reassembler = Reassembler{},
+                         TCPReceiver receiver = TCPReceiver{})
       : TestHarness(move(test_name), "capacity=" + std::to_string(capacity),
-                    {{ByteStream{capacity}, Reassembler{}}, TCPReceiver{}}) {}
+                    {{ByteStream{capacity}, std::move(reassembler)},
+                     std::move(receiver)}) {}
 
   template <std::derived_from<TestStep<StreamAndReassembler>> T>
   void execute(const T& test) {
@@ -52,6 +56,22 @@ struct ExpectWindow : public ExpectNumber<ReceiverSet, uint16_t> {
   }
 };
 
+struct ExpectWindowScale : public ExpectNumber<ReceiverSet, uint8_t> {
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "window_scale"; }
+  uint8_t value(ReceiverSet& rs) const override {
+    return rs.second.send(rs.first.first.writer()).window_scale;
+  }
+};
+
+struct ExpectTsecr : public ExpectNumber<ReceiverSet, std::optional<uint32_t>> {
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "tsecr"; }
+  std::optional<uint32_t> value(ReceiverSet& rs) const override {
+    return rs.second.send(rs.first.first.writer()).tsecr;
+  }
+};
+
 struct ExpectAckno : public ExpectNumber<ReceiverSet, std::optional<Wrap32>> {
   using ExpectNumber::ExpectNumber;
   std::string name() const override { return "ackno"; }
@@ -87,6 +107,94 @@ struct ExpectAcknoBetween : public Expectation<ReceiverSet> {
   }
 };
 
+struct ExpectSackBlocks : public Expectation<ReceiverSet> {
+  std::vector<std::pair<Wrap32, Wrap32>> blocks_;
+  explicit ExpectSackBlocks(std::vector<std::pair<Wrap32, Wrap32>> blocks)
+      : blocks_(std::move(blocks)) {}
+
+  static std::string describe(
+      const std::vector<std::pair<Wrap32, Wrap32>>& blocks) {
+    std::string ret = "{";
+    for (const auto& [left, right] : blocks) {
+      ret += " [" + to_string(left) + ", " + to_string(right) + ")";
+    }
+    return ret + " }";
+  }
+
+  std::string description() const override {
+    return "sack_blocks = " + describe(blocks_);
+  }
+
+  void execute(ReceiverSet& rs) const override {
+    const TCPReceiverMessage msg = rs.second.send(rs.first.first.writer());
+    std::vector<std::pair<Wrap32, Wrap32>> actual;
+    for (const auto& block : msg.sack_blocks) {
+      actual.emplace_back(block.left_edge, block.right_edge);
+    }
+    if (actual != blocks_) {
+      throw ExpectationViolation{
+          "The TCPReceiver should have sent sack_blocks = " +
+          describe(blocks_) + ", but instead it was " + describe(actual) + "."};
+    }
+  }
+};
+
+struct ExpectAckSent : public ExpectBool<ReceiverSet> {
+  using ExpectBool::ExpectBool;
+  std::string name() const override { return "maybe_send().has_value()"; }
+  bool value(ReceiverSet& rs) const override {
+    return rs.second.maybe_send(rs.first.first.writer()).has_value();
+  }
+};
+
+struct TimePasses : public Action<ReceiverSet> {
+  uint64_t ms_;
+  explicit TimePasses(uint64_t ms) : ms_(ms) {}
+  std::string description() const override {
+    return std::to_string(ms_) + " ms pass";
+  }
+  void execute(ReceiverSet& rs) const override { rs.second.tick(ms_); }
+};
+
+struct ShrinkReceiveBuffer : public Action<ReceiverSet> {
+  std::string description() const override {
+    return "shrink receive buffer";
+  }
+  void execute(ReceiverSet& rs) const override {
+    rs.second.shrink_receive_buffer(rs.first.first.writer());
+  }
+};
+
+struct ExpectRttEstimate : public ExpectNumber<ReceiverSet, uint64_t> {
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "rtt_estimate_ms"; }
+  uint64_t value(ReceiverSet& rs) const override {
+    return rs.second.rtt_estimate_ms();
+  }
+};
+
+struct ExpectPredicted : public Expectation<ReceiverSet> {
+  uint64_t hits_, misses_;
+  ExpectPredicted(uint64_t hits, uint64_t misses)  // NOLINT(*-swappable-*)
+      : hits_(hits), misses_(misses) {}
+
+  std::string description() const override {
+    return "predicted_hits = " + std::to_string(hits_) +
+           ", predicted_misses = " + std::to_string(misses_);
+  }
+
+  void execute(ReceiverSet& rs) const override {
+    if (rs.second.predicted_hits() != hits_) {
+      throw ExpectationViolation("predicted_hits", hits_,
+                                 rs.second.predicted_hits());
+    }
+    if (rs.second.predicted_misses() != misses_) {
+      throw ExpectationViolation("predicted_misses", misses_,
+                                 rs.second.predicted_misses());
+    }
+  }
+};
+
 struct HasAckno : public ExpectBool<ReceiverSet> {
   using ExpectBool::ExpectBool;
   std::string name() const override { return "ackno.has_value()"; }
@@ -118,6 +226,21 @@ struct SegmentArrives : public Action<ReceiverSet> {
     return with_seqno(Wrap32{seqno_});
   }
 
+  SegmentArrives& with_window_scale(uint8_t window_scale) {
+    msg_.window_scale = window_scale;
+    return *this;
+  }
+
+  SegmentArrives& with_tsval(uint32_t tsval) {
+    msg_.tsval = tsval;
+    return *this;
+  }
+
+  SegmentArrives& with_sack_permitted() {
+    msg_.sack_permitted = true;
+    return *this;
+  }
+
   SegmentArrives& with_data(std::string data) {
     msg_.payload = move(data);
     return *this;
@@ -140,6 +263,15 @@ struct SegmentArrives : public Action<ReceiverSet> {
     if (msg_.SYN) {
       ss << " +SYN";
     }
+    if (msg_.window_scale.has_value()) {
+      ss << " wscale=" << static_cast<int>(msg_.window_scale.value());
+    }
+    if (msg_.tsval.has_value()) {
+      ss << " tsval=" << msg_.tsval.value();
+    }
+    if (msg_.sack_permitted) {
+      ss << " +SACK-permitted";
+    }
     if (not msg_.payload.empty()) {
       ss << " payload=\"" << Printer::prettify(msg_.payload) << "\"";
     }
@@ -156,3 +288,26 @@ struct SegmentArrives : public Action<ReceiverSet> {
     return ss.str();
   }
 };
+
+struct SegmentsArrive : public Action<ReceiverSet> {
+  std::vector<SegmentArrives> segments_;
+
+  explicit SegmentsArrive(std::vector<SegmentArrives> segments)
+      : segments_(std::move(segments)) {}
+
+  void execute(ReceiverSet& rs) const override {
+    std::vector<TCPSenderMessage> messages;
+    for (const auto& segment : segments_) {
+      messages.push_back(segment.msg_);
+    }
+    rs.second.receive_batch(messages, rs.first.second, rs.first.first.writer());
+  }
+
+  std::string description() const override {
+    std::string ret = "receive batch {";
+    for (const auto& segment : segments_) {
+      ret += " " + segment.description() + ";";
+    }
+    return ret + " }";
+  }
+};
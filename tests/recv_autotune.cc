@@ -0,0 +1,229 @@
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "random.hh"
+#include "receiver_test_harness.hh"
+
+using namespace std;
+
+int main() {
+  try {
+    auto rd = get_random_engine();
+    const auto autotuning = [](uint64_t max_capacity) {
+      return TCPReceiver{TCPConfig::MAX_SACK_BLOCKS, {},
+                         TCPReceiver::Autotune{max_capacity, 1000}};
+    };
+    const string kilobyte(1000, 'x');
+
+    {
+      const uint32_t isn =
+          uniform_int_distribution<uint32_t>{0, UINT32_MAX}(rd);
+      TCPReceiverTestHarness test{"fixed capacity by default", 1000};
+      test.execute(SegmentArrives{}.with_syn().with_seqno(isn));
+      test.execute(TimePasses{10});
+      test.execute(SegmentArrives{}.with_seqno(isn + 1).with_data(kilobyte));
+      test.execute(ReadAll{kilobyte});
+      test.execute(TimePasses{10});
+      test.execute(
+          SegmentArrives{}.with_seqno(isn + 1001).with_data(kilobyte));
+      test.execute(ReadAll{kilobyte});
+      test.execute(TimePasses{10});
+      test.execute(
+          SegmentArrives{}.with_seqno(isn + 2001).with_data(kilobyte));
+      test.execute(ExpectWindow{0});
+      test.execute(ExpectRttEstimate{0});
+    }
+
+    for (const uint64_t max_capacity : {64000, 2500}) {
+      const uint32_t isn =
+          uniform_int_distribution<uint32_t>{0, UINT32_MAX}(rd);
+      TCPReceiverTestHarness test{"grows with the application", 1000,
+                                  Reassembler{}, autotuning(max_capacity)};
+      test.execute(SegmentArrives{}.with_syn().with_seqno(isn));
+      test.execute(TimePasses{10});
+      test.execute(SegmentArrives{}.with_seqno(isn + 1).with_data(kilobyte));
+      test.execute(ExpectRttEstimate{10});
+      test.execute(ExpectWindow{0});
+
+      // Two windows read in one RTT: room for twice that, up to the ceiling
+      test.execute(ReadAll{kilobyte});
+      test.execute(TimePasses{5});
+      test.execute(
+          SegmentArrives{}.with_seqno(isn + 1001).with_data(kilobyte));
+      test.execute(ExpectWindow{0});
+      test.execute(ReadAll{kilobyte});
+      test.execute(TimePasses{5});
+      test.execute(
+          SegmentArrives{}.with_seqno(isn + 2001).with_data(kilobyte));
+      test.execute(
+          ExpectWindow{static_cast<uint16_t>(min<uint64_t>(max_capacity,
+                                                           4000) -
+                                             1000)});
+      test.execute(ExpectAckno{Wrap32{isn + 3001}});
+    }
+
+    {
+      const uint32_t isn =
+          uniform_int_distribution<uint32_t>{0, UINT32_MAX}(rd);
+      TCPReceiverTestHarness test{"steady reader grows", 20000,
+                                  Reassembler{}, autotuning(64000)};
+      const string burst(15000, 'x');
+      test.execute(SegmentArrives{}.with_syn().with_seqno(isn));
+      test.execute(TimePasses{10});
+      test.execute(SegmentArrives{}.with_seqno(isn + 1).with_data(burst));
+      test.execute(ReadAll{burst});
+      test.execute(TimePasses{10});
+
+      // 15000 bytes read in the 20 ms RTT: more than the ten segments
+      // autotuning starts from, though less than the whole buffer
+      test.execute(SegmentArrives{}.with_seqno(isn + 15001).with_data(burst));
+      test.execute(ExpectRttEstimate{20});
+      test.execute(ExpectWindow{15000});
+      test.execute(ReadAll{burst});
+      test.execute(TimePasses{20});
+      test.execute(SegmentArrives{}.with_seqno(isn + 30001).with_data(burst));
+      test.execute(ExpectWindow{15000});
+    }
+
+    {
+      const uint32_t isn =
+          uniform_int_distribution<uint32_t>{0, UINT32_MAX}(rd);
+      TCPReceiverTestHarness test{"slow reader doesn't grow", 1000,
+                                  Reassembler{}, autotuning(64000)};
+      test.execute(SegmentArrives{}.with_syn().with_seqno(isn));
+      test.execute(TimePasses{10});
+      test.execute(SegmentArrives{}.with_seqno(isn + 1).with_data(kilobyte));
+      test.execute(TimePasses{10});
+      test.execute(ReadAll{kilobyte});
+      test.execute(
+          SegmentArrives{}.with_seqno(isn + 1001).with_data(kilobyte));
+      test.execute(TimePasses{20});
+      test.execute(ReadAll{kilobyte});
+      test.execute(
+          SegmentArrives{}.with_seqno(isn + 2001).with_data("abc"));
+      test.execute(ExpectWindow{997});
+    }
+
+    {
+      const uint32_t isn =
+          uniform_int_distribution<uint32_t>{0, UINT32_MAX}(rd);
+      TCPReceiverTestHarness test{"shrinks under memory pressure", 1000,
+                                  Reassembler{}, autotuning(64000)};
+      test.execute(SegmentArrives{}.with_syn().with_seqno(isn));
+      test.execute(TimePasses{10});
+      test.execute(SegmentArrives{}.with_seqno(isn + 1).with_data(kilobyte));
+      test.execute(ReadAll{kilobyte});
+      test.execute(TimePasses{5});
+      test.execute(
+          SegmentArrives{}.with_seqno(isn + 1001).with_data(kilobyte));
+      test.execute(ReadAll{kilobyte});
+      test.execute(TimePasses{5});
+      test.execute(
+          SegmentArrives{}.with_seqno(isn + 2001).with_data(kilobyte));
+      test.execute(
+          SegmentArrives{}.with_seqno(isn + 3001).with_data(kilobyte));
+      test.execute(ExpectWindow{2000});
+
+      // The buffer comes down to the minimum once the peer has filled the
+      // window already sent
+      test.execute(ShrinkReceiveBuffer{});
+      test.execute(ExpectWindow{2000});
+      test.execute(ReadAll{kilobyte + kilobyte});
+      test.execute(ExpectWindow{2000});
+      test.execute(SegmentArrives{}.with_seqno(isn + 4001).with_data(
+          kilobyte + kilobyte));
+      test.execute(ExpectWindow{0});
+      test.execute(ReadAll{kilobyte + kilobyte});
+      test.execute(ExpectWindow{1000});
+      test.execute(ShrinkReceiveBuffer{});
+      test.execute(ExpectWindow{1000});
+    }
+
+    {
+      const uint32_t isn =
+          uniform_int_distribution<uint32_t>{0, UINT32_MAX}(rd);
+      TCPReceiverTestHarness test{"keeps the advertised window", 1000,
+                                  Reassembler{}, autotuning(64000)};
+      test.execute(SegmentArrives{}.with_syn().with_seqno(isn));
+      test.execute(TimePasses{10});
+      test.execute(SegmentArrives{}.with_seqno(isn + 1).with_data(kilobyte));
+      test.execute(ReadAll{kilobyte});
+      test.execute(TimePasses{5});
+      test.execute(
+          SegmentArrives{}.with_seqno(isn + 1001).with_data(kilobyte));
+      test.execute(ReadAll{kilobyte});
+      test.execute(TimePasses{5});
+      test.execute(
+          SegmentArrives{}.with_seqno(isn + 2001).with_data(kilobyte));
+      test.execute(ExpectWindow{3000});
+      test.execute(ExpectAckSent{true});
+
+      // The edge at 6000 stays, and the window shrinks as data fills it
+      test.execute(ShrinkReceiveBuffer{});
+      test.execute(ExpectWindow{3000});
+      test.execute(
+          SegmentArrives{}.with_seqno(isn + 3001).with_data(kilobyte));
+      test.execute(ExpectWindow{2000});
+      test.execute(ReadAll{kilobyte + kilobyte});
+      test.execute(ExpectWindow{2000});
+      test.execute(
+          SegmentArrives{}.with_seqno(isn + 4001).with_data(kilobyte));
+      test.execute(ExpectWindow{1000});
+
+      // Once the application has read up to the target, the window opens
+      // no further than the autotuning minimum
+      test.execute(ReadAll{kilobyte});
+      test.execute(SegmentArrives{}.with_seqno(isn + 5001).with_data("x"));
+      test.execute(ExpectWindow{999});
+      test.execute(ReadAll{"x"});
+      test.execute(ExpectWindow{1000});
+    }
+
+    {
+      const uint32_t isn =
+          uniform_int_distribution<uint32_t>{0, UINT32_MAX}(rd);
+      TCPReceiverTestHarness test{"keeps a window sent by send()", 1000,
+                                  Reassembler{}, autotuning(64000)};
+      test.execute(SegmentArrives{}.with_syn().with_seqno(isn));
+      test.execute(TimePasses{10});
+      test.execute(SegmentArrives{}.with_seqno(isn + 1).with_data(kilobyte));
+      test.execute(ReadAll{kilobyte});
+      test.execute(TimePasses{5});
+      test.execute(
+          SegmentArrives{}.with_seqno(isn + 1001).with_data(kilobyte));
+      test.execute(ReadAll{kilobyte});
+      test.execute(TimePasses{5});
+      test.execute(
+          SegmentArrives{}.with_seqno(isn + 2001).with_data(kilobyte));
+
+      // send() advertises the edge at 6000, with no maybe_send()
+      test.execute(ExpectWindow{3000});
+      test.execute(ShrinkReceiveBuffer{});
+      test.execute(ExpectWindow{3000});
+      test.execute(ReadAll{kilobyte});
+      test.execute(ExpectWindow{3000});
+      test.execute(
+          SegmentArrives{}.with_seqno(isn + 3001).with_data(kilobyte));
+      test.execute(ExpectWindow{2000});
+    }
+
+    {
+      const uint32_t isn =
+          uniform_int_distribution<uint32_t>{0, UINT32_MAX}(rd);
+      TCPReceiverTestHarness test{"scale covers the ceiling", 1000,
+                                  Reassembler{}, autotuning(1 << 20)};
+      test.execute(
+          SegmentArrives{}.with_syn().with_seqno(isn).with_window_scale(0));
+      test.execute(ExpectWindowScale{5});
+      test.execute(ExpectWindow{1000 >> 5});
+    }
+  } catch (const exception& e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
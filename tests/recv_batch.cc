@@ -0,0 +1,72 @@
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "random.hh"
+#include "receiver_test_harness.hh"
+
+using namespace std;
+
+int main() {
+  try {
+    auto rd = get_random_engine();
+
+    for (const auto engine :
+         {Reassembler::Engine::segment_map, Reassembler::Engine::byte_ring,
+          Reassembler::Engine::interval_set}) {
+      {
+        const uint32_t isn =
+            uniform_int_distribution<uint32_t>{0, UINT32_MAX}(rd);
+        TCPReceiverTestHarness test{"batch with SYN, data and FIN", 4000,
+                                    Reassembler{engine}};
+        test.execute(SegmentsArrive{
+            {SegmentArrives{}.with_syn().with_seqno(isn),
+             SegmentArrives{}.with_seqno(isn + 5).with_data("efgh").with_fin(),
+             SegmentArrives{}.with_seqno(isn + 1).with_data("abcd")}});
+        test.execute(ExpectAckno{Wrap32{isn + 10}});
+        test.execute(ReadAll{"abcdefgh"});
+        test.execute(IsFinished{true});
+      }
+
+      {
+        const uint32_t isn =
+            uniform_int_distribution<uint32_t>{0, UINT32_MAX}(rd);
+        TCPReceiverTestHarness test{"batch reordered with a hole", 4000,
+                                    Reassembler{engine}};
+        test.execute(
+            SegmentArrives{}.with_syn().with_seqno(isn).with_sack_permitted());
+        test.execute(SegmentsArrive{
+            {SegmentArrives{}.with_seqno(isn + 9).with_data("ijkl"),
+             SegmentArrives{}.with_seqno(isn + 1).with_data("abcd"),
+             SegmentArrives{}.with_seqno(isn + 13).with_data("mnop")}});
+        test.execute(ExpectAckno{Wrap32{isn + 5}});
+        test.execute(BytesPending{8});
+        test.execute(ExpectSackBlocks{{{Wrap32{isn + 9}, Wrap32{isn + 17}}}});
+        test.execute(SegmentsArrive{
+            {SegmentArrives{}.with_seqno(isn + 5).with_data("efgh")}});
+        test.execute(ExpectAckno{Wrap32{isn + 17}});
+        test.execute(ReadAll{"abcdefghijklmnop"});
+      }
+
+      {
+        const uint32_t isn =
+            uniform_int_distribution<uint32_t>{0, UINT32_MAX}(rd);
+        TCPReceiverTestHarness test{"batch before SYN is dropped", 4000,
+                                    Reassembler{engine}};
+        test.execute(SegmentsArrive{
+            {SegmentArrives{}.with_seqno(isn + 1).with_data("abcd")}});
+        test.execute(HasAckno{false});
+        test.execute(SegmentArrives{}.with_syn().with_seqno(isn));
+        test.execute(ExpectAckno{Wrap32{isn + 1}});
+        test.execute(BytesPushed{0});
+      }
+    }
+  } catch (const exception& e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,139 @@
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "random.hh"
+#include "receiver_test_harness.hh"
+
+using namespace std;
+
+int main() {
+  try {
+    auto rd = get_random_engine();
+    const TCPReceiver::DelayedAck delayed{40, 4};
+    const auto delaying = [&delayed] {
+      return TCPReceiver{TCPConfig::MAX_SACK_BLOCKS, delayed};
+    };
+
+    {
+      const uint32_t isn =
+          uniform_int_distribution<uint32_t>{0, UINT32_MAX}(rd);
+      TCPReceiverTestHarness test{"every segment acked by default", 4000};
+      test.execute(ExpectAckSent{false});
+      test.execute(SegmentArrives{}.with_syn().with_seqno(isn));
+      test.execute(ExpectAckSent{true});
+      test.execute(ExpectAckSent{false});
+      test.execute(SegmentArrives{}.with_seqno(isn + 1).with_data("abcd"));
+      test.execute(ExpectAckSent{true});
+      test.execute(SegmentArrives{}.with_seqno(isn + 5).with_data("efgh"));
+      test.execute(ExpectAckSent{true});
+      test.execute(ExpectAckSent{false});
+    }
+
+    {
+      const uint32_t isn =
+          uniform_int_distribution<uint32_t>{0, UINT32_MAX}(rd);
+      TCPReceiverTestHarness test{"ack every second full segment", 4000,
+                                  Reassembler{}, delaying()};
+      test.execute(SegmentArrives{}.with_syn().with_seqno(isn));
+      test.execute(ExpectAckSent{true});
+      test.execute(SegmentArrives{}.with_seqno(isn + 1).with_data("abcd"));
+      test.execute(ExpectAckSent{false});
+      test.execute(SegmentArrives{}.with_seqno(isn + 5).with_data("efgh"));
+      test.execute(ExpectAckSent{true});
+      test.execute(SegmentArrives{}.with_seqno(isn + 9).with_data("ijkl"));
+      test.execute(ExpectAckSent{false});
+      test.execute(SegmentArrives{}.with_seqno(isn + 13).with_data("mn"));
+      test.execute(ExpectAckSent{false});
+      test.execute(SegmentArrives{}.with_seqno(isn + 15).with_data("opqr"));
+      test.execute(ExpectAckSent{true});
+      test.execute(ExpectAckno{Wrap32{isn + 19}});
+    }
+
+    {
+      const uint32_t isn =
+          uniform_int_distribution<uint32_t>{0, UINT32_MAX}(rd);
+      TCPReceiverTestHarness test{"ack after the delay", 4000, Reassembler{},
+                                  delaying()};
+      test.execute(SegmentArrives{}.with_syn().with_seqno(isn));
+      test.execute(ExpectAckSent{true});
+      test.execute(TimePasses{100});
+      test.execute(ExpectAckSent{false});
+      test.execute(SegmentArrives{}.with_seqno(isn + 1).with_data("ab"));
+      test.execute(TimePasses{39});
+      test.execute(ExpectAckSent{false});
+      test.execute(TimePasses{1});
+      test.execute(ExpectAckSent{true});
+      test.execute(TimePasses{100});
+      test.execute(ExpectAckSent{false});
+    }
+
+    {
+      const uint32_t isn =
+          uniform_int_distribution<uint32_t>{0, UINT32_MAX}(rd);
+      TCPReceiverTestHarness test{"immediate ack out of order", 4000,
+                                  Reassembler{}, delaying()};
+      test.execute(SegmentArrives{}.with_syn().with_seqno(isn));
+      test.execute(ExpectAckSent{true});
+      test.execute(SegmentArrives{}.with_seqno(isn + 5).with_data("efgh"));
+      test.execute(ExpectAckSent{true});
+      test.execute(SegmentArrives{}.with_seqno(isn + 1).with_data("abcd"));
+      test.execute(ExpectAckSent{true});
+      test.execute(ExpectAckno{Wrap32{isn + 9}});
+      test.execute(SegmentArrives{}.with_seqno(isn + 1).with_data("abcd"));
+      test.execute(ExpectAckSent{true});
+      test.execute(SegmentArrives{}.with_seqno(isn + 9).with_fin());
+      test.execute(ExpectAckSent{true});
+    }
+
+    {
+      const uint32_t isn =
+          uniform_int_distribution<uint32_t>{0, UINT32_MAX}(rd);
+      TCPReceiverTestHarness test{"window update", 12, Reassembler{},
+                                  delaying()};
+      test.execute(SegmentArrives{}.with_syn().with_seqno(isn));
+      test.execute(ExpectAckSent{true});
+      test.execute(
+          SegmentArrives{}.with_seqno(isn + 1).with_data("abcdefghijkl"));
+      test.execute(ExpectAckSent{false});
+      test.execute(TimePasses{40});
+      test.execute(ExpectAckSent{true});
+      test.execute(ExpectWindow{0});
+      test.execute(ReadAll{"abcdefghijkl"});
+      test.execute(ExpectAckSent{true});
+      test.execute(ExpectWindow{12});
+      test.execute(ExpectAckSent{false});
+    }
+
+    {
+      const uint32_t isn =
+          uniform_int_distribution<uint32_t>{0, UINT32_MAX}(rd);
+      TCPReceiverTestHarness test{"no silly window updates", 12,
+                                  Reassembler{}, delaying()};
+      test.execute(SegmentArrives{}.with_syn().with_seqno(isn));
+      test.execute(ExpectAckSent{true});
+      test.execute(
+          SegmentArrives{}.with_seqno(isn + 1).with_data("abcdefghijkl"));
+      test.execute(TimePasses{40});
+      test.execute(ExpectAckSent{true});
+
+      // A zero window opening by one byte is not worth an update, nor is
+      // any less than half the 12-byte buffer (two segments would be 8)
+      test.execute(Pop{1});
+      test.execute(ExpectAckSent{false});
+      test.execute(Pop{4});
+      test.execute(ExpectAckSent{false});
+      test.execute(Pop{1});
+      test.execute(ExpectAckSent{true});
+      test.execute(ExpectWindow{6});
+      test.execute(ExpectAckSent{false});
+    }
+  } catch (const exception& e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
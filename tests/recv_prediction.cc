@@ -0,0 +1,111 @@
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "random.hh"
+#include "receiver_test_harness.hh"
+
+using namespace std;
+
+int main() {
+  try {
+    auto rd = get_random_engine();
+
+    for (const auto engine :
+         {Reassembler::Engine::segment_map, Reassembler::Engine::byte_ring,
+          Reassembler::Engine::interval_set}) {
+      {
+        const uint32_t isn =
+            uniform_int_distribution<uint32_t>{0, UINT32_MAX}(rd);
+        TCPReceiverTestHarness test{"in-order data is predicted", 4000,
+                                    Reassembler{engine}};
+        test.execute(SegmentArrives{}.with_syn().with_seqno(isn));
+        test.execute(ExpectPredicted{0, 1});
+        test.execute(SegmentArrives{}.with_seqno(isn + 1).with_data("abcd"));
+        test.execute(SegmentArrives{}.with_seqno(isn + 5).with_data("efgh"));
+        test.execute(ExpectPredicted{2, 1});
+        test.execute(ExpectAckno{Wrap32{isn + 9}});
+        test.execute(ExpectWindow{3992});
+        test.execute(ReadAll{"abcdefgh"});
+        test.execute(SegmentArrives{}.with_seqno(isn + 9).with_fin());
+        test.execute(ExpectPredicted{2, 2});
+        test.execute(ExpectAckno{Wrap32{isn + 10}});
+        test.execute(IsFinished{true});
+      }
+
+      {
+        const uint32_t isn =
+            uniform_int_distribution<uint32_t>{0, UINT32_MAX}(rd);
+        TCPReceiverTestHarness test{"out of order falls back", 4000,
+                                    Reassembler{engine}};
+        test.execute(
+            SegmentArrives{}.with_syn().with_seqno(isn).with_sack_permitted());
+        test.execute(SegmentArrives{}.with_seqno(isn + 5).with_data("efgh"));
+        test.execute(ExpectPredicted{0, 2});
+        // In order, but bytes are held: reassembly is needed
+        test.execute(SegmentArrives{}.with_seqno(isn + 1).with_data("abcd"));
+        test.execute(ExpectPredicted{0, 3});
+        test.execute(ExpectSackBlocks{{}});
+        test.execute(SegmentArrives{}.with_seqno(isn + 9).with_data("ijkl"));
+        test.execute(ExpectPredicted{1, 3});
+        test.execute(SegmentArrives{}.with_seqno(isn + 9).with_data("ijkl"));
+        test.execute(ExpectPredicted{1, 4});
+        test.execute(ExpectAckno{Wrap32{isn + 13}});
+        test.execute(ReadAll{"abcdefghijkl"});
+      }
+
+      {
+        const uint32_t isn =
+            uniform_int_distribution<uint32_t>{0, UINT32_MAX}(rd);
+        TCPReceiverTestHarness test{"window overflow falls back", 4,
+                                    Reassembler{engine}};
+        test.execute(SegmentArrives{}.with_syn().with_seqno(isn));
+        test.execute(SegmentArrives{}.with_seqno(isn + 1).with_data("abcdef"));
+        test.execute(ExpectPredicted{0, 2});
+        test.execute(ExpectAckno{Wrap32{isn + 5}});
+        test.execute(ReadAll{"abcd"});
+      }
+
+      {
+        const uint32_t isn =
+            uniform_int_distribution<uint32_t>{0, UINT32_MAX}(rd);
+        TCPReceiverTestHarness test{"predicted data completes the stream",
+                                    4000, Reassembler{engine}};
+        test.execute(SegmentArrives{}.with_syn().with_seqno(isn));
+        test.execute(SegmentArrives{}.with_seqno(isn + 5).with_fin());
+        test.execute(SegmentArrives{}.with_seqno(isn + 1).with_data("abcd"));
+        test.execute(ExpectPredicted{1, 2});
+        test.execute(ExpectAckno{Wrap32{isn + 6}});
+        test.execute(ReadAll{"abcd"});
+        test.execute(IsFinished{true});
+      }
+
+      {
+        const uint32_t isn =
+            uniform_int_distribution<uint32_t>{0, UINT32_MAX}(rd);
+        TCPReceiverTestHarness test{"old timestamp falls back to PAWS", 4000,
+                                    Reassembler{engine}};
+        test.execute(
+            SegmentArrives{}.with_syn().with_seqno(isn).with_tsval(10));
+        test.execute(SegmentArrives{}
+                         .with_seqno(isn + 1)
+                         .with_data("abcd")
+                         .with_tsval(20));
+        test.execute(ExpectTsecr{20});
+        test.execute(SegmentArrives{}
+                         .with_seqno(isn + 5)
+                         .with_data("efgh")
+                         .with_tsval(15));
+        test.execute(ExpectPredicted{1, 2});
+        test.execute(ExpectAckno{Wrap32{isn + 5}});
+      }
+    }
+  } catch (const exception& e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,122 @@
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "random.hh"
+#include "receiver_test_harness.hh"
+
+using namespace std;
+
+int main() {
+  try {
+    auto rd = get_random_engine();
+
+    for (const auto engine :
+         {Reassembler::Engine::segment_map, Reassembler::Engine::byte_ring,
+          Reassembler::Engine::interval_set}) {
+      {
+        const uint32_t isn =
+            uniform_int_distribution<uint32_t>{0, UINT32_MAX}(rd);
+        TCPReceiverTestHarness test{"no sack blocks in order", 4000,
+                                    Reassembler{engine}};
+        test.execute(
+            SegmentArrives{}.with_syn().with_seqno(isn).with_sack_permitted());
+        test.execute(ExpectSackBlocks{{}});
+        test.execute(SegmentArrives{}.with_seqno(isn + 1).with_data("abcd"));
+        test.execute(ExpectAckno{Wrap32{isn + 5}});
+        test.execute(ExpectSackBlocks{{}});
+      }
+
+      {
+        const uint32_t isn =
+            uniform_int_distribution<uint32_t>{0, UINT32_MAX}(rd);
+        TCPReceiverTestHarness test{"no sack blocks unless permitted", 4000,
+                                    Reassembler{engine}};
+        test.execute(SegmentArrives{}.with_syn().with_seqno(isn));
+        test.execute(SegmentArrives{}.with_seqno(isn + 11).with_data("klm"));
+        test.execute(ExpectAckno{Wrap32{isn + 1}});
+        test.execute(ExpectSackBlocks{{}});
+      }
+
+      {
+        const uint32_t isn =
+            uniform_int_distribution<uint32_t>{0, UINT32_MAX}(rd);
+        TCPReceiverTestHarness test{"most recent block first", 4000,
+                                    Reassembler{engine}};
+        test.execute(
+            SegmentArrives{}.with_syn().with_seqno(isn).with_sack_permitted());
+        test.execute(SegmentArrives{}.with_seqno(isn + 11).with_data("klm"));
+        test.execute(
+            ExpectSackBlocks{{{Wrap32{isn + 11}, Wrap32{isn + 14}}}});
+        test.execute(SegmentArrives{}.with_seqno(isn + 3).with_data("cd"));
+        test.execute(ExpectSackBlocks{{{Wrap32{isn + 3}, Wrap32{isn + 5}},
+                                       {Wrap32{isn + 11}, Wrap32{isn + 14}}}});
+        test.execute(SegmentArrives{}.with_seqno(isn + 20).with_data("tu"));
+        test.execute(ExpectSackBlocks{{{Wrap32{isn + 20}, Wrap32{isn + 22}},
+                                       {Wrap32{isn + 3}, Wrap32{isn + 5}},
+                                       {Wrap32{isn + 11}, Wrap32{isn + 14}}}});
+        test.execute(ExpectAckno{Wrap32{isn + 1}});
+      }
+
+      {
+        const uint32_t isn =
+            uniform_int_distribution<uint32_t>{0, UINT32_MAX}(rd);
+        TCPReceiverTestHarness test{"blocks grow and merge", 4000,
+                                    Reassembler{engine}};
+        test.execute(
+            SegmentArrives{}.with_syn().with_seqno(isn).with_sack_permitted());
+        test.execute(SegmentArrives{}.with_seqno(isn + 3).with_data("cd"));
+        test.execute(SegmentArrives{}.with_seqno(isn + 7).with_data("gh"));
+        test.execute(SegmentArrives{}.with_seqno(isn + 5).with_data("ef"));
+        test.execute(ExpectSackBlocks{{{Wrap32{isn + 3}, Wrap32{isn + 9}}}});
+        test.execute(SegmentArrives{}.with_seqno(isn + 1).with_data("ab"));
+        test.execute(ExpectAckno{Wrap32{isn + 9}});
+        test.execute(ExpectSackBlocks{{}});
+        test.execute(ReadAll{"abcdefgh"});
+      }
+
+      {
+        const uint32_t isn =
+            uniform_int_distribution<uint32_t>{0, UINT32_MAX}(rd);
+        TCPReceiverTestHarness test{"filled hole drops its block", 4000,
+                                    Reassembler{engine}};
+        test.execute(
+            SegmentArrives{}.with_syn().with_seqno(isn).with_sack_permitted());
+        test.execute(SegmentArrives{}.with_seqno(isn + 5).with_data("ef"));
+        test.execute(SegmentArrives{}.with_seqno(isn + 9).with_data("ij"));
+        test.execute(SegmentArrives{}.with_seqno(isn + 1).with_data("abcd"));
+        test.execute(ExpectAckno{Wrap32{isn + 7}});
+        test.execute(ExpectSackBlocks{{{Wrap32{isn + 9}, Wrap32{isn + 11}}}});
+      }
+
+      {
+        const uint32_t isn =
+            uniform_int_distribution<uint32_t>{0, UINT32_MAX}(rd);
+        TCPReceiverTestHarness test{"at most four blocks", 4000,
+                                    Reassembler{engine}};
+        test.execute(
+            SegmentArrives{}.with_syn().with_seqno(isn).with_sack_permitted());
+        for (uint32_t i = 0; i < 6; ++i) {
+          test.execute(
+              SegmentArrives{}.with_seqno(isn + 10 * (i + 1)).with_data("x"));
+        }
+        test.execute(ExpectSackBlocks{{{Wrap32{isn + 60}, Wrap32{isn + 61}},
+                                       {Wrap32{isn + 50}, Wrap32{isn + 51}},
+                                       {Wrap32{isn + 40}, Wrap32{isn + 41}},
+                                       {Wrap32{isn + 30}, Wrap32{isn + 31}}}});
+        test.execute(SegmentArrives{}.with_seqno(isn + 20).with_data("x"));
+        test.execute(ExpectSackBlocks{{{Wrap32{isn + 20}, Wrap32{isn + 21}},
+                                       {Wrap32{isn + 60}, Wrap32{isn + 61}},
+                                       {Wrap32{isn + 50}, Wrap32{isn + 51}},
+                                       {Wrap32{isn + 40}, Wrap32{isn + 41}}}});
+      }
+    }
+  } catch (const exception& e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
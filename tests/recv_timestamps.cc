@@ -0,0 +1,132 @@
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+#include "random.hh"
+#include "receiver_test_harness.hh"
+
+using namespace std;
+
+int main() {
+  try {
+    auto rd = get_random_engine();
+
+    {
+      const uint32_t isn =
+          uniform_int_distribution<uint32_t>{0, UINT32_MAX}(rd);
+      TCPReceiverTestHarness test{"no timestamps unless the SYN has one",
+                                  4000};
+      test.execute(SegmentArrives{}.with_syn().with_seqno(isn));
+      test.execute(ExpectTsecr{nullopt});
+      test.execute(
+          SegmentArrives{}.with_seqno(isn + 1).with_data("abcd").with_tsval(7));
+      test.execute(ExpectTsecr{nullopt});
+      test.execute(ExpectAckno{Wrap32{isn + 5}});
+    }
+
+    {
+      const uint32_t isn =
+          uniform_int_distribution<uint32_t>{0, UINT32_MAX}(rd);
+      TCPReceiverTestHarness test{"echo the segment that advanced the ackno",
+                                  4000};
+      test.execute(SegmentArrives{}.with_syn().with_seqno(isn).with_tsval(100));
+      test.execute(ExpectTsecr{100});
+      test.execute(SegmentArrives{}
+                       .with_seqno(isn + 1)
+                       .with_data("abcd")
+                       .with_tsval(105));
+      test.execute(ExpectTsecr{105});
+      test.execute(SegmentArrives{}
+                       .with_seqno(isn + 11)
+                       .with_data("klm")
+                       .with_tsval(110));
+      test.execute(ExpectTsecr{105});
+      test.execute(SegmentArrives{}
+                       .with_seqno(isn + 5)
+                       .with_data("efghij")
+                       .with_tsval(115));
+      test.execute(ExpectTsecr{115});
+      test.execute(ExpectAckno{Wrap32{isn + 14}});
+
+      // A retransmission of acknowledged data is still echoed
+      test.execute(SegmentArrives{}
+                       .with_seqno(isn + 1)
+                       .with_data("abcd")
+                       .with_tsval(120));
+      test.execute(ExpectTsecr{120});
+    }
+
+    {
+      const uint32_t isn =
+          uniform_int_distribution<uint32_t>{0, UINT32_MAX}(rd);
+      TCPReceiverTestHarness test{"PAWS drops old duplicates", 4000};
+      test.execute(SegmentArrives{}.with_syn().with_seqno(isn).with_tsval(100));
+      test.execute(ExpectAckSent{true});
+      test.execute(SegmentArrives{}
+                       .with_seqno(isn + 1)
+                       .with_data("abcd")
+                       .with_tsval(105));
+      test.execute(ExpectAckSent{true});
+      test.execute(SegmentArrives{}
+                       .with_seqno(isn + 5)
+                       .with_data("efgh")
+                       .with_tsval(90));
+      test.execute(ExpectAckno{Wrap32{isn + 5}});
+      test.execute(ExpectTsecr{105});
+      test.execute(BytesPushed{4});
+      test.execute(ExpectAckSent{true});
+      test.execute(SegmentArrives{}
+                       .with_seqno(isn + 5)
+                       .with_data("efgh")
+                       .with_tsval(105));
+      test.execute(ExpectAckno{Wrap32{isn + 9}});
+    }
+
+    {
+      const uint32_t isn =
+          uniform_int_distribution<uint32_t>{0, UINT32_MAX}(rd);
+      TCPReceiverTestHarness test{"PAWS across timestamp wrap", 4000};
+      test.execute(SegmentArrives{}.with_syn().with_seqno(isn).with_tsval(
+          UINT32_MAX - 5));
+      test.execute(
+          SegmentArrives{}.with_seqno(isn + 1).with_data("abcd").with_tsval(5));
+      test.execute(ExpectAckno{Wrap32{isn + 5}});
+      test.execute(ExpectTsecr{5});
+      test.execute(SegmentArrives{}
+                       .with_seqno(isn + 5)
+                       .with_data("efgh")
+                       .with_tsval(UINT32_MAX));
+      test.execute(ExpectAckno{Wrap32{isn + 5}});
+    }
+
+    {
+      const uint32_t isn =
+          uniform_int_distribution<uint32_t>{0, UINT32_MAX}(rd);
+      TCPReceiverTestHarness test{
+          "delayed ACK echoes the earliest held-back segment", 4000,
+          Reassembler{},
+          TCPReceiver{TCPConfig::MAX_SACK_BLOCKS,
+                      TCPReceiver::DelayedAck{40, 4}}};
+      test.execute(SegmentArrives{}.with_syn().with_seqno(isn).with_tsval(1));
+      test.execute(ExpectAckSent{true});
+      test.execute(
+          SegmentArrives{}.with_seqno(isn + 1).with_data("abcd").with_tsval(2));
+      test.execute(ExpectAckSent{false});
+      test.execute(
+          SegmentArrives{}.with_seqno(isn + 5).with_data("efgh").with_tsval(3));
+      test.execute(ExpectTsecr{2});
+      test.execute(ExpectAckSent{true});
+      test.execute(
+          SegmentArrives{}.with_seqno(isn + 9).with_data("ijkl").with_tsval(4));
+      test.execute(ExpectTsecr{4});
+    }
+  } catch (const exception& e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -106,6 +106,35 @@ int main() {
       test.execute(BytesPending(0));
     }
 
+    {
+      const uint32_t isn = 23452;
+      TCPReceiverTestHarness test{"no window scale unless offered", 1000000};
+      test.execute(SegmentArrives{}.with_syn().with_seqno(isn));
+      test.execute(ExpectWindow{UINT16_MAX});
+      test.execute(ExpectWindowScale{0});
+    }
+
+    {
+      const uint32_t isn = 23452;
+      TCPReceiverTestHarness test{"window scaled to cover capacity", 1000000};
+      test.execute(
+          SegmentArrives{}.with_syn().with_seqno(isn).with_window_scale(7));
+      test.execute(ExpectWindowScale{4});
+      test.execute(ExpectWindow{1000000 >> 4});
+      test.execute(
+          SegmentArrives{}.with_seqno(isn + 1).with_data(string(1000, 'x')));
+      test.execute(ExpectWindow{(1000000 - 1000) >> 4});
+    }
+
+    {
+      const uint32_t isn = 23452;
+      TCPReceiverTestHarness test{"small window needs no scale", 4000};
+      test.execute(
+          SegmentArrives{}.with_syn().with_seqno(isn).with_window_scale(7));
+      test.execute(ExpectWindowScale{0});
+      test.execute(ExpectWindow{4000});
+    }
+
   } catch (const exception& e) {
     cerr << e.what() << endl;
     return 1;
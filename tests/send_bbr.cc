@@ -0,0 +1,163 @@
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <set>
+#include <string>
+
+#include "congestion_control.hh"
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+using namespace std;
+
+namespace {
+
+constexpr uint64_t kMSS = TCPConfig::MAX_PAYLOAD_SIZE;
+constexpr uint64_t kIW = TCPConfig::INITIAL_CWND_SEGMENTS * kMSS;
+
+}  // namespace
+
+int main() {
+  try {
+    auto rd = get_random_engine();
+
+    {
+      // The SYN takes 100 ms, so BBR starts pacing at the startup gain times
+      // the initial window per 100 ms: a segment every 3.5 ms
+      TCPConfig cfg;
+      const Wrap32 isn(rd());
+      cfg.fixed_isn = isn;
+
+      TCPSenderTestHarness test{"BBR paces from the SYN's RTT", cfg, BBR{}};
+      test.execute(Push{});
+      test.execute(ExpectMessage{}.with_syn(true));
+      test.execute(ExpectPacingRate{nullopt});
+      test.execute(Tick{100});
+      test.execute(Receive{{isn + 1, 60000}});
+      test.execute(ExpectPacingRate{
+          static_cast<uint64_t>(BBR::kHighGain * kIW / 100)});
+
+      test.execute(Push{string(10 * kMSS, 'x')});
+      test.execute(ExpectSegmentsSent{0});
+      const set<uint64_t> send_times{1, 4, 7, 11, 14, 18, 21, 25, 28, 32};
+      for (uint64_t ms = 1; ms <= 32; ++ms) {
+        test.execute(Tick{1});
+        test.execute(ExpectSegmentsSent{send_times.contains(ms) ? 1U : 0U});
+      }
+
+      // The last is acknowledged 100 ms after it was sent: 10000 bytes
+      // delivered over the 131 ms since the first was sent
+      test.execute(Tick{100});
+      test.execute(Receive{{isn + 1 + 10 * kMSS, 60000}});
+      test.execute(ExpectDelivered{10 * kMSS + 1});
+      test.execute(ExpectMinRtt{100});
+      test.execute(ExpectBottleneckBandwidth{10 * kMSS / 131});
+    }
+
+    {
+      // A path of 100 bytes/ms and 50 ms, a BDP of 5000 bytes: each 50 ms
+      // round trip, the receiver acknowledges five more segments. Anything
+      // else sent waits in the bottleneck's queue.
+      TCPConfig cfg;
+      const Wrap32 isn(rd());
+      cfg.fixed_isn = isn;
+      cfg.rt_timeout = 60'000;
+      cfg.send_capacity = 1'000'000;
+      constexpr uint64_t kBDP = 5000;
+
+      TCPSenderTestHarness test{"BBR models the path", cfg, BBR{}};
+      const auto round = [&](size_t segments) {
+        test.execute(SendAll{});
+        test.execute(Tick{50});
+        test.execute(AckSegments{segments, 60000});
+      };
+
+      test.execute(Push{});
+      test.execute(ExpectMessage{}.with_syn(true));
+      test.execute(Tick{50});
+      test.execute(AckAllSent{60000});
+      test.execute(ExpectBBRState{BBR::State::startup});
+      test.execute(ExpectMinRtt{50});
+      test.execute(Push{string(cfg.send_capacity, 'x')});
+
+      // Startup's first round, paced before it had a model, sends nothing
+      test.execute(SendAll{});
+      test.execute(Tick{50});
+      round(5);
+      test.execute(ExpectBottleneckBandwidth{100});
+
+      // Startup keeps raising cwnd until three rounds (by what they deliver,
+      // so longer as the queue grows) bring no 25% more bandwidth
+      for (int i = 0; i < 9; ++i) {
+        round(5);
+      }
+      test.execute(ExpectBBRState{BBR::State::startup});
+      round(5);
+      test.execute(ExpectBBRState{BBR::State::drain});
+      test.execute(
+          ExpectPacingRate{static_cast<uint64_t>(100 / BBR::kHighGain)});
+
+      // Once the queue is gone, cruise at the bandwidth with two BDPs in
+      // flight
+      for (int i = 0; i < 3; ++i) {
+        round(5);
+      }
+      test.execute(ExpectBBRState{BBR::State::drain});
+      round(5);
+      test.execute(ExpectBBRState{BBR::State::probe_bw});
+      test.execute(ExpectPacingRate{100});
+      test.execute(ExpectCwnd{2 * kBDP + 3 * kMSS});
+
+      // Cruising for six min RTTs, then a probe, then a drain
+      for (int i = 0; i < 11; ++i) {
+        round(5);
+      }
+      test.execute(ExpectPacingRate{100});
+      round(5);
+      test.execute(ExpectPacingRate{125});
+      for (int i = 0; i < 2; ++i) {
+        round(5);
+      }
+      test.execute(ExpectPacingRate{75});
+      for (int i = 0; i < 2; ++i) {
+        round(5);
+      }
+      test.execute(ExpectPacingRate{100});
+
+      // Ten seconds without a lower RTT: hold four segments in flight for a
+      // round and 200 ms to measure it again
+      test.execute(SendAll{});
+      test.execute(Tick{10'001});
+      test.execute(AckSegments{5, 60000});
+      test.execute(ExpectBBRState{BBR::State::probe_rtt});
+      test.execute(ExpectCwnd{BBR::kMinCwndSegments * kMSS});
+      for (int i = 0; i < 3; ++i) {
+        round(5);
+      }
+      test.execute(ExpectMinRtt{50});
+      round(5);
+      test.execute(ExpectBBRState{BBR::State::probe_rtt});
+      round(5);
+      test.execute(ExpectBBRState{BBR::State::probe_bw});
+
+      // The bandwidth is the max over ten rounds, so once the path slows
+      // down the old max ages out
+      for (int i = 0; i < 10; ++i) {
+        round(5);
+      }
+      test.execute(ExpectBottleneckBandwidth{100});
+      test.execute(ExpectCwnd{2 * kBDP + 3 * kMSS});
+      for (int i = 0; i < 65; ++i) {
+        round(2);
+      }
+      test.execute(ExpectBottleneckBandwidth{40});
+      test.execute(ExpectCwnd{2 * kBDP * 40 / 100 + 3 * kMSS});
+    }
+  } catch (const exception& e) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,333 @@
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "congestion_control.hh"
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+using namespace std;
+
+namespace {
+
+constexpr uint64_t kMSS = TCPConfig::MAX_PAYLOAD_SIZE;
+constexpr uint64_t kIW = TCPConfig::INITIAL_CWND_SEGMENTS * kMSS;
+
+TCPConfig config_with_isn(Wrap32 isn) {
+  TCPConfig cfg;
+  cfg.fixed_isn = isn;
+  cfg.send_capacity = 1'000'000;
+  return cfg;
+}
+
+// Acknowledge `bytes` of the stream, with a 60000-byte window
+Receive ack(Wrap32 isn, uint64_t bytes) {
+  return Receive{{isn + static_cast<uint32_t>(1 + bytes), 60000}};
+}
+
+// Send the SYN and have it acknowledged. Every policy counts the SYN as one
+// byte acknowledged, so slow start leaves cwnd at IW + 1.
+void connect(TCPSenderTestHarness& test, Wrap32 isn) {
+  test.execute(Push{});
+  test.execute(ExpectMessage{}.with_syn(true));
+  test.execute(ack(isn, 0));
+}
+
+template <typename CC>
+void fast_retransmit_test(Wrap32 isn, const string& name,
+                          uint64_t cwnd_after_loss,
+                          bool retransmit_on_partial) {
+  TCPSenderTestHarness test{name, config_with_isn(isn), CC{}};
+  connect(test, isn);
+  test.execute(Push{string(8 * kMSS, 'x')});
+  test.execute(ExpectSegmentsSent{8});
+  test.execute(ack(isn, 0));
+  test.execute(ack(isn, 0));
+  test.execute(ExpectNoSegment{});
+  test.execute(ack(isn, 0));
+  test.execute(ExpectMessage{}.with_seqno(isn + 1).with_payload_size(kMSS));
+  test.execute(ExpectCwnd{cwnd_after_loss});
+  test.execute(ExpectInRecovery{true});
+  test.execute(ack(isn, 0));
+  test.execute(ExpectNoSegment{});
+
+  // The first segment was the only one lost, and then the third
+  test.execute(ack(isn, 2 * kMSS));
+  if (retransmit_on_partial) {
+    test.execute(ExpectMessage{}.with_seqno(isn + 1 + 2 * kMSS));
+    test.execute(ExpectInRecovery{true});
+    test.execute(ExpectCwnd{cwnd_after_loss});
+  } else {
+    test.execute(ExpectNoSegment{});
+    test.execute(ExpectInRecovery{false});
+  }
+  test.execute(ack(isn, 8 * kMSS));
+  test.execute(ExpectInRecovery{false});
+  test.execute(ExpectSeqnosInFlight{0});
+}
+
+template <typename CC>
+void two_losses_test(Wrap32 isn, const string& name,
+                     bool retransmit_on_partial) {
+  // Segments 2 and 5 of ten are lost
+  TCPSenderTestHarness test{name, config_with_isn(isn), CC{}};
+  connect(test, isn);
+  test.execute(Push{string(10 * kMSS, 'x')});
+  test.execute(SendAll{});
+  for (int i = 0; i < 4; ++i) {
+    test.execute(ack(isn, 2 * kMSS));
+  }
+  test.execute(ExpectMessage{}.with_seqno(isn + 1 + 2 * kMSS));
+  test.execute(ack(isn, 5 * kMSS));
+  if (not retransmit_on_partial) {
+    // Reno leaves recovery, and the second hole waits for the timeout
+    test.execute(ExpectNoSegment{});
+    test.execute(Tick{TCPConfig::TIMEOUT_DFLT});
+  }
+  test.execute(ExpectMessage{}.with_seqno(isn + 1 + 5 * kMSS));
+  test.execute(ack(isn, 10 * kMSS));
+  test.execute(ExpectSeqnosInFlight{0});
+}
+
+}  // namespace
+
+int main() {
+  try {
+    auto rd = get_random_engine();
+
+    {
+      const Wrap32 isn(rd());
+      TCPSenderTestHarness test{"Reno", config_with_isn(isn), Reno{}};
+      test.execute(ExpectCwnd{kIW});
+      connect(test, isn);
+      test.execute(ExpectCwnd{kIW + 1});
+      test.execute(ExpectSsthresh{UINT64_MAX});
+
+      // The window, not the stream or the receiver, limits what is sent
+      test.execute(Push{string(50 * kMSS, 'x')});
+      test.execute(ExpectSeqnosInFlight{kIW + 1});
+      test.execute(SendAll{});
+      test.execute(ack(isn, kMSS));
+      test.execute(ExpectCwnd{kIW + 1 + kMSS});
+      test.execute(ExpectSeqnosInFlight{kIW + 1 + kMSS});
+
+      // One segment per ACK in slow start, however much it acknowledges
+      test.execute(ack(isn, 6 * kMSS));
+      test.execute(ExpectCwnd{kIW + 1 + 2 * kMSS});
+      test.execute(SendAll{});
+
+      // 12001 bytes are outstanding at the third duplicate ACK
+      for (int i = 0; i < 3; ++i) {
+        test.execute(ack(isn, 6 * kMSS));
+      }
+      test.execute(ExpectMessage{}.with_seqno(isn + 1 + 6 * kMSS));
+      test.execute(ExpectSsthresh{6 * kMSS});
+      test.execute(ExpectCwnd{6 * kMSS});
+      test.execute(ExpectInRecovery{true});
+      test.execute(ack(isn, 7 * kMSS));
+      test.execute(ExpectInRecovery{false});
+      test.execute(ExpectNoSegment{});
+
+      // One segment per window acknowledged. The one-byte segment sent
+      // when cwnd was IW + 1 ends at 10001.
+      test.execute(ack(isn, 10 * kMSS));
+      test.execute(ack(isn, 10 * kMSS + 1));
+      test.execute(ack(isn, 12 * kMSS + 1));
+      test.execute(ExpectCwnd{6 * kMSS});
+      test.execute(ack(isn, 13 * kMSS + 1));
+      test.execute(ExpectCwnd{7 * kMSS});
+
+      test.execute(SendAll{});
+      test.execute(Tick{TCPConfig::TIMEOUT_DFLT});
+      test.execute(ExpectCwnd{kMSS});
+      test.execute(ExpectSsthresh{7 * kMSS / 2});
+      test.execute(ExpectMessage{}.with_seqno(isn + 1 + 13 * kMSS + 1));
+    }
+
+    {
+      const Wrap32 isn(rd());
+      TCPSenderTestHarness test{"NewReno stays in recovery until a full ACK",
+                                config_with_isn(isn), NewReno{}};
+      connect(test, isn);
+      test.execute(Push{string(kIW, 'x')});
+      test.execute(SendAll{});
+      for (int i = 0; i < 3; ++i) {
+        test.execute(ack(isn, 0));
+      }
+      test.execute(ExpectMessage{}.with_seqno(isn + 1));
+      test.execute(ExpectCwnd{kIW / 2});
+      test.execute(ack(isn, kMSS));
+      test.execute(ExpectMessage{}.with_seqno(isn + 1 + kMSS));
+      test.execute(ExpectInRecovery{true});
+      test.execute(ExpectCwnd{kIW / 2});
+      test.execute(ack(isn, kIW));
+      test.execute(ExpectInRecovery{false});
+      test.execute(ExpectCwnd{kIW / 2});
+    }
+
+    {
+      // Without a policy the sender is limited by the receiver's window alone
+      const Wrap32 isn(rd());
+      TCPSenderTestHarness test{"Sender without congestion control",
+                                config_with_isn(isn)};
+      connect(test, isn);
+      test.execute(Push{string(50 * kMSS, 'x')});
+      test.execute(ExpectSeqnosInFlight{50 * kMSS});
+    }
+
+    {
+      // A 100 ms RTT, and a loss at a window of 100 segments. One ACK per
+      // round trip acknowledges the whole window.
+      const Wrap32 isn(rd());
+      TCPConfig cfg = config_with_isn(isn);
+      cfg.send_capacity = 20'000'000;
+      TCPSenderTestHarness test{"CUBIC", cfg, Cubic{}};
+      constexpr uint64_t kRTT = 100;
+      const auto round = [&] {
+        test.execute(SendAll{});
+        test.execute(Tick{kRTT});
+        test.execute(AckAllSent{60000}.with_win_scale(2));
+      };
+
+      test.execute(Push{});
+      test.execute(ExpectMessage{}.with_syn(true));
+      test.execute(Tick{kRTT});
+      test.execute(AckAllSent{60000}.with_win_scale(2));
+      test.execute(Push{string(cfg.send_capacity, 'x')});
+      uint64_t acked = 0;
+      uint64_t cwnd = kIW + 1;
+      while (cwnd < 100 * kMSS) {
+        round();
+        acked += cwnd;
+        cwnd += kMSS;
+        test.execute(ExpectCwnd{cwnd});
+      }
+
+      test.execute(SendAll{});
+      for (int i = 0; i < 3; ++i) {
+        test.execute(ack(isn, acked).with_win_scale(2));
+      }
+      test.execute(ExpectMessage{}.with_seqno(isn + 1 + acked));
+      test.execute(ExpectCwnd{cwnd * 7 / 10});
+      test.execute(AckAllSent{60000}.with_win_scale(2));
+      test.execute(ExpectInRecovery{false});
+
+      // W(t) = C (t - K)^3 + W_max, with K = cbrt(W_max (1 - beta) / C):
+      // about 4.2 s, or 42 rounds. Concave up to W_max: fast at first...
+      for (int i = 0; i < 10; ++i) {
+        round();
+      }
+      test.execute(ExpectCwndBetween{85 * kMSS, 88 * kMSS});
+
+      // ...then flat around it...
+      for (int i = 0; i < 22; ++i) {
+        round();
+      }
+      test.execute(ExpectCwndBetween{99 * kMSS, 100 * kMSS});
+      for (int i = 0; i < 10; ++i) {
+        round();
+      }
+      test.execute(ExpectCwndBetween{99 * kMSS, 101 * kMSS});
+
+      // ...then probing past it
+      for (int i = 0; i < 38; ++i) {
+        round();
+      }
+      test.execute(ExpectCwndBetween{115 * kMSS, 125 * kMSS});
+    }
+
+    // Reno halves the 8 segments in flight, and CUBIC takes 0.7 of cwnd
+    fast_retransmit_test<Reno>(Wrap32(rd()), "Reno fast retransmit", 4 * kMSS,
+                               false);
+    fast_retransmit_test<NewReno>(Wrap32(rd()), "NewReno fast retransmit",
+                                  4 * kMSS, true);
+    fast_retransmit_test<Cubic>(Wrap32(rd()), "CUBIC fast retransmit",
+                                (kIW + 1) * 7 / 10, true);
+    two_losses_test<Reno>(Wrap32(rd()), "Reno with two losses", false);
+    two_losses_test<NewReno>(Wrap32(rd()), "NewReno with two losses", true);
+
+    {
+      // After a timeout everything outstanding is presumed lost: once the
+      // first five are acknowledged, the sixth goes right away, not after
+      // another timeout
+      const Wrap32 isn(rd());
+      TCPSenderTestHarness test{"Reno after a timeout", config_with_isn(isn),
+                                Reno{}};
+      connect(test, isn);
+      test.execute(Push{string(10 * kMSS, 'x')});
+      test.execute(SendAll{});
+      test.execute(Tick{TCPConfig::TIMEOUT_DFLT});
+      test.execute(ExpectMessage{}.with_seqno(isn + 1));
+      test.execute(ExpectNoSegment{});
+      test.execute(ack(isn, 5 * kMSS));
+      test.execute(ExpectMessage{}.with_seqno(isn + 1 + 5 * kMSS));
+      test.execute(ExpectSegmentsSent{1});
+      test.execute(ack(isn, 7 * kMSS));
+      test.execute(ExpectSegmentsSent{3});
+      test.execute(ack(isn, 10 * kMSS));
+      test.execute(ExpectSeqnosInFlight{0});
+      test.execute(Tick{1}.with_max_retx_exceeded(false));
+    }
+
+    {
+      // Timeouts of a zero-window probe say nothing about congestion
+      const Wrap32 isn(rd());
+      TCPSenderTestHarness test{"Reno probing a zero window",
+                                config_with_isn(isn), Reno{}};
+      connect(test, isn);
+      test.execute(Receive{{isn + 1, 0}});
+      test.execute(Push{string(kMSS, 'x')});
+      test.execute(ExpectSegmentsSent{1});
+      test.execute(Tick{TCPConfig::TIMEOUT_DFLT});
+      test.execute(ExpectMessage{}.with_seqno(isn + 1));
+      test.execute(ExpectCwnd{kIW + 1});
+      test.execute(ExpectSsthresh{UINT64_MAX});
+    }
+
+    {
+      const Wrap32 isn(rd());
+      TCPSenderTestHarness test{"make_congestion_control(\"cubic\")",
+                                config_with_isn(isn),
+                                AnyCongestionControl{"cubic"}};
+      connect(test, isn);
+      test.execute(Push{string(50 * kMSS, 'x')});
+      test.execute(ExpectCwnd{kIW + 1});
+      test.execute(ExpectSeqnosInFlight{kIW + 1});
+    }
+
+    {
+      const Wrap32 isn(rd());
+      TCPSenderTestHarness test{"make_congestion_control(\"bbr\")",
+                                config_with_isn(isn),
+                                AnyCongestionControl{"bbr"}};
+      connect(test, isn);
+      test.execute(Push{string(50 * kMSS, 'x')});
+      test.execute(ExpectCwnd{kIW + 1});
+      test.execute(ExpectSeqnosInFlight{kIW + 1});
+    }
+
+    {
+      const Wrap32 isn(rd());
+      TCPSenderTestHarness test{"make_congestion_control(\"none\")",
+                                config_with_isn(isn),
+                                AnyCongestionControl{"none"}};
+      connect(test, isn);
+      test.execute(Push{string(50 * kMSS, 'x')});
+      test.execute(ExpectSeqnosInFlight{50 * kMSS});
+    }
+
+    try {
+      make_congestion_control("vegas");
+      throw runtime_error{"make_congestion_control accepted \"vegas\""};
+    } catch (const invalid_argument&) {
+    }
+  } catch (const exception& e) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
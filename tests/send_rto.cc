@@ -0,0 +1,176 @@
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+using namespace std;
+
+int main() {
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn(rd());
+      cfg.fixed_isn = isn;
+
+      TCPSenderTestHarness test{"Fixed RTO unless asked to adapt", cfg};
+      test.execute(Push{});
+      test.execute(ExpectMessage{}.with_syn(true));
+      test.execute(Tick{1000});
+      test.execute(ExpectMessage{}.with_syn(true));
+      test.execute(ExpectRTO{2000});
+      test.execute(Tick{10});
+      test.execute(Receive{{isn + 1, DEFAULT_TEST_WINDOW}}.without_push());
+      test.execute(ExpectRTO{1000});
+      test.execute(ExpectSrtt{nullopt});
+      test.execute(ExpectRttvar{nullopt});
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn(rd());
+      cfg.fixed_isn = isn;
+
+      TCPSenderTestHarness test{"RTO from SRTT and RTTVAR", cfg,
+                                RTTEstimator::Bounds{1, 60000}};
+      test.execute(ExpectRTO{1000});
+      test.execute(ExpectSrtt{nullopt});
+      test.execute(Push{});
+      test.execute(ExpectMessage{}.with_syn(true));
+      test.execute(Tick{100});
+      test.execute(Receive{{isn + 1, DEFAULT_TEST_WINDOW}}.without_push());
+      // SRTT = R, RTTVAR = R/2
+      test.execute(ExpectSrtt{100});
+      test.execute(ExpectRttvar{50});
+      test.execute(ExpectRTO{300});
+
+      test.execute(Push{"abc"});
+      test.execute(ExpectMessage{}.with_data("abc"));
+      test.execute(Tick{60});
+      test.execute(Receive{{isn + 4, DEFAULT_TEST_WINDOW}}.without_push());
+      // RTTVAR = 3/4 50 + 1/4 |100 - 60|, SRTT = 7/8 100 + 1/8 60
+      test.execute(ExpectSrtt{95});
+      test.execute(ExpectRttvar{47});
+      test.execute(ExpectRTO{285});
+
+      test.execute(Push{"def"});
+      test.execute(ExpectMessage{}.with_data("def"));
+      test.execute(Tick{284});
+      test.execute(ExpectNoSegment{});
+      test.execute(Tick{1});
+      test.execute(ExpectMessage{}.with_data("def"));
+      test.execute(ExpectRTO{570});
+      test.execute(Tick{570});
+      test.execute(ExpectMessage{}.with_data("def"));
+      test.execute(ExpectRTO{1140});
+
+      // Karn's algorithm: an ACK for a retransmission gives no sample, and
+      // the backed-off RTO stays until one does
+      test.execute(Tick{30});
+      test.execute(Receive{{isn + 7, DEFAULT_TEST_WINDOW}}.without_push());
+      test.execute(ExpectSrtt{95});
+      test.execute(ExpectRTO{1140});
+      test.execute(Push{"ghi"});
+      test.execute(ExpectMessage{}.with_data("ghi"));
+      test.execute(Tick{40});
+      test.execute(Receive{{isn + 10, DEFAULT_TEST_WINDOW}}.without_push());
+      test.execute(ExpectSrtt{88});
+      test.execute(ExpectRttvar{49});
+      test.execute(ExpectRTO{286});
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn(rd());
+      cfg.fixed_isn = isn;
+
+      TCPSenderTestHarness test{"No sample from an ACK covering a resend",
+                                cfg, RTTEstimator::Bounds{1, 60000}};
+      test.execute(Push{});
+      test.execute(ExpectMessage{}.with_syn(true));
+      test.execute(Tick{10});
+      test.execute(Receive{{isn + 1, DEFAULT_TEST_WINDOW}}.without_push());
+      test.execute(ExpectRTO{30});
+      test.execute(Push{"abc"});
+      test.execute(ExpectMessage{}.with_data("abc"));
+      test.execute(Push{"def"});
+      test.execute(ExpectMessage{}.with_data("def"));
+      test.execute(Tick{30});
+      test.execute(ExpectMessage{}.with_data("abc"));
+      test.execute(ExpectRTO{60});
+      // "def" was sent only once, but before the wait for the timeout
+      test.execute(Tick{10});
+      test.execute(Receive{{isn + 7, DEFAULT_TEST_WINDOW}}.without_push());
+      test.execute(ExpectSrtt{10});
+      test.execute(ExpectRttvar{5});
+      test.execute(ExpectRTO{60});
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn(rd());
+      cfg.fixed_isn = isn;
+
+      TCPSenderTestHarness test{"Timestamps time a retransmission", cfg,
+                                RTTEstimator::Bounds{1, 60000}};
+      test.execute(Push{});
+      test.execute(ExpectMessage{}.with_syn(true).with_tsval(0));
+      test.execute(Tick{10});
+      test.execute(
+          Receive{{isn + 1, DEFAULT_TEST_WINDOW}}.with_tsecr(0).without_push());
+      test.execute(ExpectRTO{30});
+      test.execute(Push{"abc"});
+      test.execute(ExpectMessage{}.with_data("abc").with_tsval(10));
+      test.execute(Tick{30});
+      test.execute(ExpectMessage{}.with_data("abc").with_tsval(40));
+      test.execute(Tick{5});
+      test.execute(Receive{{isn + 4, DEFAULT_TEST_WINDOW}}
+                       .with_tsecr(40)
+                       .without_push());
+      test.execute(ExpectRttSample{5});
+      test.execute(ExpectSrtt{9});
+      test.execute(ExpectRttvar{5});
+      test.execute(ExpectRTO{29});
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn(rd());
+      cfg.fixed_isn = isn;
+      cfg.rt_timeout = 3000;
+
+      TCPSenderTestHarness test{"RTO within its bounds", cfg,
+                                RTTEstimator::Bounds{200, 2000}};
+      test.execute(ExpectRTO{2000});
+      test.execute(Push{});
+      test.execute(ExpectMessage{}.with_syn(true));
+      test.execute(Tick{1});
+      test.execute(Receive{{isn + 1, DEFAULT_TEST_WINDOW}}.without_push());
+      test.execute(ExpectSrtt{1});
+      test.execute(ExpectRTO{200});
+
+      test.execute(Push{"abc"});
+      test.execute(ExpectMessage{}.with_data("abc"));
+      for (const uint64_t rto : {200, 400, 800, 1600}) {
+        test.execute(Tick{rto});
+        test.execute(ExpectMessage{}.with_data("abc"));
+        test.execute(ExpectRTO{min<uint64_t>(2 * rto, 2000)});
+      }
+      test.execute(Tick{2000});
+      test.execute(ExpectMessage{}.with_data("abc"));
+      test.execute(ExpectRTO{2000});
+    }
+  } catch (const exception& e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
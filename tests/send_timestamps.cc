@@ -0,0 +1,93 @@
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+using namespace std;
+
+int main() {
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn(rd());
+      cfg.fixed_isn = isn;
+
+      TCPSenderTestHarness test{"RTT sample from the echoed timestamp", cfg};
+      test.execute(Tick{3});
+      test.execute(Push{});
+      test.execute(ExpectMessage{}.with_syn(true).with_tsval(3));
+      test.execute(ExpectRttSample{nullopt});
+      test.execute(Tick{7});
+      test.execute(
+          Receive{{isn + 1, DEFAULT_TEST_WINDOW}}.with_tsecr(3).without_push());
+      test.execute(ExpectRttSample{7});
+      test.execute(Push{"abc"});
+      test.execute(ExpectMessage{}.with_data("abc").with_tsval(10));
+      test.execute(Tick{20});
+      test.execute(Receive{{isn + 4, DEFAULT_TEST_WINDOW}}
+                       .with_tsecr(10)
+                       .without_push());
+      test.execute(ExpectRttSample{20});
+      test.execute(ExpectSeqnosInFlight{0});
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn(rd());
+      const uint16_t retx_timeout =
+          uniform_int_distribution<uint16_t>{10, 10000}(rd);
+      cfg.fixed_isn = isn;
+      cfg.rt_timeout = retx_timeout;
+
+      TCPSenderTestHarness test{"RTT sample from a retransmission", cfg};
+      test.execute(Push{});
+      test.execute(ExpectMessage{}.with_syn(true).with_tsval(0));
+      test.execute(
+          Receive{{isn + 1, DEFAULT_TEST_WINDOW}}.with_tsecr(0).without_push());
+      test.execute(ExpectRttSample{0});
+      test.execute(Push{"abc"});
+      test.execute(ExpectMessage{}.with_data("abc").with_tsval(0));
+      test.execute(Tick{retx_timeout});
+      test.execute(
+          ExpectMessage{}.with_data("abc").with_tsval(retx_timeout));
+      test.execute(Tick{5});
+      test.execute(Receive{{isn + 4, DEFAULT_TEST_WINDOW}}
+                       .with_tsecr(retx_timeout)
+                       .without_push());
+      test.execute(ExpectRttSample{5});
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn(rd());
+      cfg.fixed_isn = isn;
+
+      TCPSenderTestHarness test{"No sample without an echo or new data", cfg};
+      test.execute(Push{});
+      test.execute(ExpectMessage{}.with_syn(true));
+      test.execute(Tick{4});
+      test.execute(AckReceived{isn + 1});
+      test.execute(ExpectRttSample{nullopt});
+      test.execute(Push{"abc"});
+      test.execute(ExpectMessage{}.with_data("abc").with_tsval(4));
+      test.execute(Tick{4});
+      test.execute(
+          Receive{{isn + 1, DEFAULT_TEST_WINDOW}}.with_tsecr(0).without_push());
+      test.execute(ExpectRttSample{nullopt});
+      test.execute(ExpectSeqnosInFlight{3});
+    }
+  } catch (const exception& e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -170,6 +170,29 @@ int main() {
       test.execute(ExpectMessage{}.with_fin(true).with_data("4567"));
       test.execute(ExpectNoSegment{});
     }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn(rd());
+      cfg.fixed_isn = isn;
+      cfg.send_capacity = 200000;
+
+      TCPSenderTestHarness test{"Scaled window beyond 64 KB", cfg};
+      test.execute(Push{});
+      test.execute(ExpectMessage{}
+                       .with_syn(true)
+                       .with_window_scale_offered(true)
+                       .with_seqno(isn));
+      test.execute(
+          AckReceived{Wrap32{isn + 1}}.with_win(1000).with_win_scale(7));
+      test.execute(ExpectNoSegment{});
+      test.execute(Push{string(200000, 'x')});
+      test.execute(ExpectSeqnosInFlight{128000});
+      for (int i = 0; i < 128; ++i) {
+        test.execute(ExpectMessage{}.with_no_flags().with_payload_size(1000));
+      }
+      test.execute(ExpectNoSegment{});
+    }
   } catch (const exception& e) {
     cerr << e.what() << endl;
     return 1;
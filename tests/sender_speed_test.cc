@@ -0,0 +1,111 @@
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "byte_stream.hh"
+#include "tcp_config.hh"
+#include "tcp_sender.hh"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+constexpr uint64_t kMSS = TCPConfig::MAX_PAYLOAD_SIZE;
+constexpr uint64_t kSegments = 200'000;
+
+// Keep `window` full-sized segments in flight, and clock one new segment out
+// for each one acknowledged, as a bulk transfer does in steady state. Returns
+// the sender's cost per segment: push, maybe_send and receive of its ACK.
+double speed_test(const uint64_t window) {
+  const Wrap32 isn{0};
+  ByteStream stream{(window + 1) * kMSS, ByteStream::Storage::chunked};
+  TCPSender sender{TCPConfig::TIMEOUT_DFLT, isn};
+  const Buffer chunk{string(kMSS, 'x')};
+
+  // Advertise room for the whole window, scaled
+  const auto ack = [&](uint64_t acked_bytes) {
+    constexpr uint8_t scale = TCPConfig::MAX_WINDOW_SCALE;
+    return TCPReceiverMessage{
+        isn + static_cast<uint32_t>(1 + acked_bytes),
+        static_cast<uint16_t>((window * kMSS >> scale) + 1),
+        {},
+        scale};
+  };
+
+  sender.push(stream.reader());
+  if (not sender.maybe_send().has_value()) {
+    throw runtime_error("TCPSender did not send SYN");
+  }
+  sender.receive(ack(0));
+  for (uint64_t i = 0; i < window; ++i) {
+    stream.writer().push(chunk, 0, kMSS);
+  }
+  sender.push(stream.reader());
+  while (sender.maybe_send().has_value()) {
+  }
+  if (sender.sequence_numbers_in_flight() != window * kMSS) {
+    throw runtime_error("TCPSender did not fill the window");
+  }
+
+  const auto start_time = steady_clock::now();
+  for (uint64_t acked = 1; acked <= kSegments; ++acked) {
+    sender.receive(ack(acked * kMSS));
+    stream.writer().push(chunk, 0, kMSS);
+    sender.push(stream.reader());
+    if (not sender.maybe_send().has_value()) {
+      throw runtime_error("TCPSender did not clock out a segment");
+    }
+  }
+  const auto stop_time = steady_clock::now();
+
+  if (sender.sequence_numbers_in_flight() != window * kMSS) {
+    throw runtime_error("TCPSender lost track of the window");
+  }
+
+  const double ns_per_segment =
+      static_cast<double>(
+          duration_cast<nanoseconds>(stop_time - start_time).count()) /
+      static_cast<double>(kSegments);
+
+  fstream debug_output;
+  debug_output.open("/dev/tty");
+
+  cout << "TCPSender with " << window << " segments in flight: " << fixed
+       << setprecision(1) << ns_per_segment << " ns/segment.\n";
+  debug_output << "             window " << setw(6) << window
+               << " segments: " << setw(8) << fixed << setprecision(1)
+               << ns_per_segment << " ns/segment\n";
+  return ns_per_segment;
+}
+
+}  // namespace
+
+void program_body() {
+  vector<double> costs;
+  for (const uint64_t window : {16, 1024, 16384}) {
+    costs.push_back(speed_test(window));
+  }
+
+  // Bookkeeping per segment must not grow with the window
+  if (costs.back() > 4 * costs.front()) {
+    throw runtime_error(
+        "TCPSender cost per segment grew more than 4x with the window.");
+  }
+}
+
+int main() {
+  try {
+    program_body();
+  } catch (const exception &e) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
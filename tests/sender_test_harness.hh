@@ -1,10 +1,16 @@
 #pragma once
 
+#include <algorithm>
+#include <concepts>
+#include <deque>
+#include <memory>
 #include <optional>
 #include <sstream>
+#include <typeinfo>
 #include <utility>
 
 #include "common.hh"
+#include "congestion_control.hh"
 #include "tcp_config.hh"
 #include "tcp_receiver_message.hh"
 #include "tcp_sender.hh"
@@ -12,7 +18,145 @@
 
 const unsigned int DEFAULT_TEST_WINDOW = 137;
 
-using StreamAndSender = std::pair<ByteStream, TCPSender>;
+// A BasicTCPSender with any congestion control policy, behind one interface,
+// so that the same test steps drive them all
+class AnySender {
+  struct Concept {
+    virtual ~Concept() = default;
+    virtual void push(Reader& outbound_stream) = 0;
+    virtual std::optional<TCPSenderMessage> maybe_send() = 0;
+    virtual TCPSenderMessage send_empty_message() const = 0;
+    virtual void receive(const TCPReceiverMessage& msg) = 0;
+    virtual void tick(uint64_t ms_since_last_tick) = 0;
+    virtual uint64_t sequence_numbers_in_flight() const = 0;
+    virtual uint64_t consecutive_retransmissions() const = 0;
+    virtual std::optional<uint64_t> rtt_sample_ms() const = 0;
+    virtual uint64_t delivered() const = 0;
+    virtual uint64_t rto_ms() const = 0;
+    virtual std::optional<uint64_t> srtt_ms() const = 0;
+    virtual std::optional<uint64_t> rttvar_ms() const = 0;
+    virtual uint64_t cwnd() const = 0;
+    virtual bool in_recovery() const = 0;
+    virtual std::optional<double> pacing_rate() const = 0;
+    virtual std::optional<uint64_t> ssthresh() const = 0;
+  };
+
+  template <typename CC>
+  struct Model final : public Concept {
+    BasicTCPSender<CC> sender;
+
+    explicit Model(BasicTCPSender<CC> s) : sender(std::move(s)) {}
+    void push(Reader& outbound_stream) override {
+      sender.push(outbound_stream);
+    }
+    std::optional<TCPSenderMessage> maybe_send() override {
+      return sender.maybe_send();
+    }
+    TCPSenderMessage send_empty_message() const override {
+      return sender.send_empty_message();
+    }
+    void receive(const TCPReceiverMessage& msg) override {
+      sender.receive(msg);
+    }
+    void tick(uint64_t ms_since_last_tick) override {
+      sender.tick(ms_since_last_tick);
+    }
+    uint64_t sequence_numbers_in_flight() const override {
+      return sender.sequence_numbers_in_flight();
+    }
+    uint64_t consecutive_retransmissions() const override {
+      return sender.consecutive_retransmissions();
+    }
+    std::optional<uint64_t> rtt_sample_ms() const override {
+      return sender.rtt_sample_ms();
+    }
+    uint64_t delivered() const override { return sender.delivered(); }
+    uint64_t rto_ms() const override { return sender.rto_ms(); }
+    std::optional<uint64_t> srtt_ms() const override {
+      return sender.srtt_ms();
+    }
+    std::optional<uint64_t> rttvar_ms() const override {
+      return sender.rttvar_ms();
+    }
+    uint64_t cwnd() const override {
+      return sender.congestion_control().cwnd();
+    }
+    bool in_recovery() const override {
+      return sender.congestion_control().in_recovery();
+    }
+    std::optional<double> pacing_rate() const override {
+      return sender.congestion_control().pacing_rate();
+    }
+    std::optional<uint64_t> ssthresh() const override {
+      if constexpr (requires { sender.congestion_control().ssthresh(); }) {
+        return sender.congestion_control().ssthresh();
+      } else {
+        return {};
+      }
+    }
+  };
+
+  std::unique_ptr<Concept> impl_;
+  // The end of each segment sent and not yet acknowledged, oldest first
+  std::deque<Wrap32> unacked_ends_{};
+
+ public:
+  template <typename CC>
+  explicit AnySender(BasicTCPSender<CC> sender)
+      : impl_(std::make_unique<Model<CC>>(std::move(sender))) {}
+
+  void push(Reader& outbound_stream) { impl_->push(outbound_stream); }
+  std::optional<TCPSenderMessage> maybe_send() {
+    auto msg = impl_->maybe_send();
+    if (msg.has_value() and msg->sequence_length()) {
+      const Wrap32 end = msg->seqno + msg->sequence_length();
+      if (unacked_ends_.empty() or unacked_ends_.back() < end) {
+        unacked_ends_.push_back(end);
+      }
+    }
+    return msg;
+  }
+  TCPSenderMessage send_empty_message() const {
+    return impl_->send_empty_message();
+  }
+  void receive(const TCPReceiverMessage& msg) {
+    impl_->receive(msg);
+    while (msg.ackno.has_value() and not unacked_ends_.empty() and
+           unacked_ends_.front() <= msg.ackno.value()) {
+      unacked_ends_.pop_front();
+    }
+  }
+  const std::deque<Wrap32>& unacked_segment_ends() const {
+    return unacked_ends_;
+  }
+  void tick(uint64_t ms_since_last_tick) { impl_->tick(ms_since_last_tick); }
+  uint64_t sequence_numbers_in_flight() const {
+    return impl_->sequence_numbers_in_flight();
+  }
+  uint64_t consecutive_retransmissions() const {
+    return impl_->consecutive_retransmissions();
+  }
+  std::optional<uint64_t> rtt_sample_ms() const {
+    return impl_->rtt_sample_ms();
+  }
+  uint64_t delivered() const { return impl_->delivered(); }
+  uint64_t rto_ms() const { return impl_->rto_ms(); }
+  std::optional<uint64_t> srtt_ms() const { return impl_->srtt_ms(); }
+  std::optional<uint64_t> rttvar_ms() const { return impl_->rttvar_ms(); }
+
+  // The policy's common hooks, its slow-start threshold if it keeps one, and
+  // the policy itself (which must be `CC`)
+  uint64_t cwnd() const { return impl_->cwnd(); }
+  bool in_recovery() const { return impl_->in_recovery(); }
+  std::optional<double> pacing_rate() const { return impl_->pacing_rate(); }
+  std::optional<uint64_t> ssthresh() const { return impl_->ssthresh(); }
+  template <typename CC>
+  const CC& congestion_control() const {
+    return dynamic_cast<const Model<CC>&>(*impl_).sender.congestion_control();
+  }
+};
+
+using StreamAndSender = std::pair<ByteStream, AnySender>;
 
 static std::string to_string(const TCPSenderMessage& msg) {
   std::ostringstream o;
@@ -53,6 +197,170 @@ struct ExpectSeqnosInFlight : public ExpectNumber<StreamAndSender, uint64_t> {
   }
 };
 
+struct ExpectRttSample
+    : public ExpectNumber<StreamAndSender, std::optional<uint64_t>> {
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "rtt_sample_ms"; }
+  std::optional<uint64_t> value(StreamAndSender& ss) const override {
+    return ss.second.rtt_sample_ms();
+  }
+};
+
+struct ExpectRTO : public ExpectNumber<StreamAndSender, uint64_t> {
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "rto_ms"; }
+  uint64_t value(StreamAndSender& ss) const override {
+    return ss.second.rto_ms();
+  }
+};
+
+struct ExpectSrtt
+    : public ExpectNumber<StreamAndSender, std::optional<uint64_t>> {
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "srtt_ms"; }
+  std::optional<uint64_t> value(StreamAndSender& ss) const override {
+    return ss.second.srtt_ms();
+  }
+};
+
+struct ExpectRttvar
+    : public ExpectNumber<StreamAndSender, std::optional<uint64_t>> {
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "rttvar_ms"; }
+  std::optional<uint64_t> value(StreamAndSender& ss) const override {
+    return ss.second.rttvar_ms();
+  }
+};
+
+struct ExpectCwnd : public ExpectNumber<StreamAndSender, uint64_t> {
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "cwnd"; }
+  uint64_t value(StreamAndSender& ss) const override {
+    return ss.second.cwnd();
+  }
+};
+
+// For policies whose window follows a curve rather than whole segments
+struct ExpectCwndBetween : public Expectation<StreamAndSender> {
+  uint64_t min_;
+  uint64_t max_;
+
+  ExpectCwndBetween(uint64_t min, uint64_t max) : min_(min), max_(max) {}
+  std::string description() const override {
+    return "cwnd between " + to_string(min_) + " and " + to_string(max_);
+  }
+  void execute(StreamAndSender& ss) const override {
+    const uint64_t cwnd = ss.second.cwnd();
+    if (cwnd < min_ or cwnd > max_) {
+      throw ExpectationViolation{"cwnd was " + to_string(cwnd) +
+                                 ", but it should have been between " +
+                                 to_string(min_) + " and " + to_string(max_)};
+    }
+  }
+};
+
+struct ExpectSsthresh
+    : public ExpectNumber<StreamAndSender, std::optional<uint64_t>> {
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "ssthresh"; }
+  std::optional<uint64_t> value(StreamAndSender& ss) const override {
+    return ss.second.ssthresh();
+  }
+};
+
+struct ExpectInRecovery : public ExpectBool<StreamAndSender> {
+  using ExpectBool::ExpectBool;
+  std::string name() const override { return "in_recovery"; }
+  bool value(StreamAndSender& ss) const override {
+    return ss.second.in_recovery();
+  }
+};
+
+// In whole bytes per ms
+struct ExpectPacingRate
+    : public ExpectNumber<StreamAndSender, std::optional<uint64_t>> {
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "pacing_rate"; }
+  std::optional<uint64_t> value(StreamAndSender& ss) const override {
+    const auto rate = ss.second.pacing_rate();
+    if (not rate.has_value()) {
+      return {};
+    }
+    return static_cast<uint64_t>(rate.value());
+  }
+};
+
+struct ExpectDelivered : public ExpectNumber<StreamAndSender, uint64_t> {
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "delivered"; }
+  uint64_t value(StreamAndSender& ss) const override {
+    return ss.second.delivered();
+  }
+};
+
+struct ExpectBBRState : public Expectation<StreamAndSender> {
+  BBR::State state_;
+
+  explicit ExpectBBRState(BBR::State state) : state_(state) {}
+  static std::string state_name(BBR::State state) {
+    switch (state) {
+      case BBR::State::startup:
+        return "startup";
+      case BBR::State::drain:
+        return "drain";
+      case BBR::State::probe_bw:
+        return "probe_bw";
+      case BBR::State::probe_rtt:
+        return "probe_rtt";
+    }
+    return "unknown";
+  }
+  std::string description() const override {
+    return "BBR state = " + state_name(state_);
+  }
+  void execute(StreamAndSender& ss) const override {
+    const BBR::State state = ss.second.congestion_control<BBR>().state();
+    if (state != state_) {
+      throw ExpectationViolation{"BBR state was " + state_name(state) +
+                                 ", but it should have been " +
+                                 state_name(state_)};
+    }
+  }
+};
+
+// In whole bytes per ms
+struct ExpectBottleneckBandwidth
+    : public ExpectNumber<StreamAndSender, uint64_t> {
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "bottleneck_bandwidth"; }
+  uint64_t value(StreamAndSender& ss) const override {
+    return static_cast<uint64_t>(
+        ss.second.congestion_control<BBR>().bottleneck_bandwidth());
+  }
+};
+
+struct ExpectMinRtt
+    : public ExpectNumber<StreamAndSender, std::optional<uint64_t>> {
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "min_rtt_ms"; }
+  std::optional<uint64_t> value(StreamAndSender& ss) const override {
+    return ss.second.congestion_control<BBR>().min_rtt_ms();
+  }
+};
+
+// Send everything the sender will send right now, and count the segments
+struct ExpectSegmentsSent : public ExpectNumber<StreamAndSender, uint64_t> {
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "segments sent"; }
+  uint64_t value(StreamAndSender& ss) const override {
+    uint64_t segments = 0;
+    while (ss.second.maybe_send().has_value()) {
+      ++segments;
+    }
+    return segments;
+  }
+};
+
 struct ExpectNoSegment : public Expectation<StreamAndSender> {
   std::string description() const override { return "nothing to send"; }
   void execute(StreamAndSender& ss) const override {
@@ -146,8 +454,15 @@ struct Receive : public Action<StreamAndSender> {
   explicit Receive(TCPReceiverMessage msg) : msg_(msg) {}
   std::string description() const override {
     std::ostringstream desc;
-    desc << "receive(ack=" << to_string(msg_.ackno)
-         << ", win=" << msg_.window_size << ")";
+    desc << "receive(ack=" << ackno_description()
+         << ", win=" << msg_.window_size;
+    if (msg_.window_scale != 0) {
+      desc << ", wscale=" << static_cast<int>(msg_.window_scale);
+    }
+    if (msg_.tsecr.has_value()) {
+      desc << ", tsecr=" << msg_.tsecr.value();
+    }
+    desc << ")";
     if (push_) {
       desc << ", then push stream to TCPSender";
     }
@@ -159,8 +474,18 @@ struct Receive : public Action<StreamAndSender> {
     return *this;
   }
 
+  Receive& with_win_scale(uint8_t win_scale) {
+    msg_.window_scale = win_scale;
+    return *this;
+  }
+
+  Receive& with_tsecr(uint32_t tsecr) {
+    msg_.tsecr = tsecr;
+    return *this;
+  }
+
   void execute(StreamAndSender& ss) const override {
-    ss.second.receive(msg_);
+    ss.second.receive(message(ss));
     if (push_) {
       ss.second.push(ss.first.reader());
     }
@@ -170,6 +495,12 @@ struct Receive : public Action<StreamAndSender> {
     push_ = false;
     return *this;
   }
+
+ protected:
+  virtual std::string ackno_description() const {
+    return to_string(msg_.ackno);
+  }
+  virtual TCPReceiverMessage message(StreamAndSender&) const { return msg_; }
 };
 
 struct AckReceived : public Receive {
@@ -180,12 +511,62 @@ struct Close : public Push {
   Close() : Push("") { with_close(); }
 };
 
+struct SendAll : public Action<StreamAndSender> {
+  std::string description() const override {
+    return "send everything the sender will send";
+  }
+  void execute(StreamAndSender& ss) const override {
+    while (ss.second.maybe_send().has_value()) {
+    }
+  }
+};
+
+// Acknowledge every sequence number sent so far
+struct AckAllSent : public Receive {
+  explicit AckAllSent(uint16_t window = DEFAULT_TEST_WINDOW)
+      : Receive({Wrap32{0}, window}) {}
+
+ protected:
+  std::string ackno_description() const override { return "everything sent"; }
+  TCPReceiverMessage message(StreamAndSender& ss) const override {
+    TCPReceiverMessage msg = msg_;
+    msg.ackno = ss.second.send_empty_message().seqno;
+    return msg;
+  }
+};
+
+// Acknowledge the oldest `segments` segments outstanding (or all of them, if
+// fewer are), as a path that delivers only so much per round trip would
+struct AckSegments : public Receive {
+  size_t segments_;
+
+  explicit AckSegments(size_t segments,
+                       uint16_t window = DEFAULT_TEST_WINDOW)
+      : Receive({Wrap32{0}, window}), segments_(segments) {}
+
+ protected:
+  std::string ackno_description() const override {
+    return "the oldest " + to_string(segments_) + " segments outstanding";
+  }
+  TCPReceiverMessage message(StreamAndSender& ss) const override {
+    const auto& ends = ss.second.unacked_segment_ends();
+    if (ends.empty()) {
+      throw ExpectationViolation{"no segments outstanding to acknowledge"};
+    }
+    TCPReceiverMessage msg = msg_;
+    msg.ackno = ends[std::min(segments_, ends.size()) - 1];
+    return msg;
+  }
+};
+
 struct ExpectMessage : public Expectation<StreamAndSender> {
   std::optional<bool> syn{};
   std::optional<bool> fin{};
   std::optional<Wrap32> seqno{};
   std::optional<std::string> data{};
   std::optional<size_t> payload_size{};
+  std::optional<bool> window_scale_offered{};
+  std::optional<uint32_t> tsval{};
 
   ExpectMessage& with_syn(bool syn_) {
     syn = syn_;
@@ -197,6 +578,16 @@ struct ExpectMessage : public Expectation<StreamAndSender> {
     return *this;
   }
 
+  ExpectMessage& with_window_scale_offered(bool offered) {
+    window_scale_offered = offered;
+    return *this;
+  }
+
+  ExpectMessage& with_tsval(uint32_t tsval_) {
+    tsval = tsval_;
+    return *this;
+  }
+
   ExpectMessage& with_no_flags() {
     syn = false;
     fin = false;
@@ -243,6 +634,12 @@ struct ExpectMessage : public Expectation<StreamAndSender> {
     if (fin.has_value()) {
       o << (fin.value() ? " +FIN" : " (no FIN)");
     }
+    if (window_scale_offered.has_value()) {
+      o << (window_scale_offered.value() ? " +wscale" : " (no wscale)");
+    }
+    if (tsval.has_value()) {
+      o << " tsval=" << tsval.value();
+    }
     return o.str();
   }
 
@@ -268,6 +665,15 @@ struct ExpectMessage : public Expectation<StreamAndSender> {
     if (fin.has_value() and seg.FIN != fin.value()) {
       throw ExpectationViolation("FIN flag", fin.value(), seg.FIN);
     }
+    if (window_scale_offered.has_value() and
+        seg.window_scale.has_value() != window_scale_offered.value()) {
+      throw ExpectationViolation("window scale option",
+                                 window_scale_offered.value(),
+                                 seg.window_scale.has_value());
+    }
+    if (tsval.has_value() and seg.tsval != tsval) {
+      throw ExpectationViolation("tsval", tsval, seg.tsval);
+    }
     if (seqno.has_value() and seg.seqno != seqno.value()) {
       throw ExpectationViolation("sequence number", seqno.value(), seg.seqno);
     }
@@ -291,10 +697,36 @@ struct ExpectMessage : public Expectation<StreamAndSender> {
 };
 
 class TCPSenderTestHarness : public TestHarness<StreamAndSender> {
+  static std::string describe(
+      const TCPConfig& config,
+      const std::optional<RTTEstimator::Bounds>& adaptive_RTO) {
+    return "initial_RTO_ms=" + to_string(config.rt_timeout) +
+           (adaptive_RTO.has_value()
+                ? ", adaptive between " + to_string(adaptive_RTO->min_RTO_ms) +
+                      " and " + to_string(adaptive_RTO->max_RTO_ms)
+                : "");
+  }
+
  public:
-  TCPSenderTestHarness(std::string name, TCPConfig config)
+  TCPSenderTestHarness(
+      std::string name, TCPConfig config,
+      std::optional<RTTEstimator::Bounds> adaptive_RTO = {})
+      : TestHarness(move(name), describe(config, adaptive_RTO),
+                    {ByteStream{config.send_capacity},
+                     AnySender{TCPSender{config.rt_timeout, config.fixed_isn,
+                                         {}, adaptive_RTO}}}) {}
+
+  // A sender with congestion control policy `CC`
+  template <typename CC>
+    requires(not std::convertible_to<CC, std::optional<RTTEstimator::Bounds>>)
+  TCPSenderTestHarness(
+      std::string name, TCPConfig config, CC congestion_control,
+      std::optional<RTTEstimator::Bounds> adaptive_RTO = {})
       : TestHarness(move(name),
-                    "initial_RTO_ms=" + to_string(config.rt_timeout),
+                    describe(config, adaptive_RTO) + ", congestion control " +
+                        demangle(typeid(CC).name()),
                     {ByteStream{config.send_capacity},
-                     TCPSender{config.rt_timeout, config.fixed_isn}}) {}
+                     AnySender{BasicTCPSender<CC>{
+                         config.rt_timeout, config.fixed_isn,
+                         std::move(congestion_control), adaptive_RTO}}}) {}
 };
@@ -29,6 +29,32 @@ int main() {
       test_should_be(Wrap32(n) != Wrap32(m), n != m);
     }
 
+    // Serial-number order (RFC 1982), including across the wrap
+    static_assert(Wrap32(1) < Wrap32(2));
+    static_assert(Wrap32(UINT32_MAX) < Wrap32(0));
+    static_assert(Wrap32(0) - Wrap32(UINT32_MAX) == 1);
+    static_assert(Wrap32(5).in_window(Wrap32(UINT32_MAX - 2), 9));
+    test_should_be(Wrap32(5).in_window(Wrap32(UINT32_MAX - 2), 8), false);
+    test_should_be(Wrap32(0) < Wrap32(1U << 31), false);
+    test_should_be(Wrap32(1U << 31) < Wrap32(0), false);
+
+    for (size_t i = 0; i < N_REPS; i++) {
+      const uint32_t n = rd();
+      const uint32_t diff = rd() % (1U << 31);
+      const Wrap32 a{n};
+      const Wrap32 b{n + diff};
+      test_should_be(b - a, static_cast<int32_t>(diff));
+      test_should_be(a - b, -static_cast<int32_t>(diff));
+      test_should_be(a < b, diff != 0);
+      test_should_be(a <= b, true);
+      test_should_be(b < a, false);
+      test_should_be(b <= a, diff == 0);
+      test_should_be(a > b, false);
+      test_should_be(b >= a, true);
+      test_should_be(b.in_window(a, diff), false);
+      test_should_be(b.in_window(a, uint64_t{diff} + 1), true);
+    }
+
   } catch (const exception& e) {
     cerr << e.what() << endl;
     return 1;
@@ -0,0 +1,156 @@
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "wrapping_integers.hh"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+class RawWrap32 : public Wrap32 {
+ public:
+  uint32_t raw_value() const { return raw_value_; }
+};
+
+// The three-candidate implementation that branchless unwrap replaced, kept
+// here as the baseline
+uint64_t legacy_unwrap(Wrap32 value, Wrap32 zero_point, uint64_t checkpoint) {
+  const uint64_t raw_value = RawWrap32{value}.raw_value();
+  const uint64_t zero = RawWrap32{zero_point}.raw_value();
+  uint64_t times = checkpoint / (1L << 32);
+  uint64_t offset;
+  if (raw_value >= zero) {
+    offset = raw_value - zero;
+  } else {
+    offset = raw_value + (1L << 32) - zero;
+  }
+
+  uint64_t res1 = times * (1L << 32) + offset;
+  uint64_t res2 = (times + 1) * (1L << 32) + offset;
+  uint64_t res3 = (times - 1) * (1L << 32) + offset;
+  uint64_t off1, off2, off3;
+  if (res1 > checkpoint) {
+    off1 = res1 - checkpoint;
+  } else {
+    off1 = checkpoint - res1;
+  }
+  if (res2 > checkpoint) {
+    off2 = res2 - checkpoint;
+  } else {
+    off2 = checkpoint - res2;
+  }
+  if (res3 > checkpoint) {
+    off3 = res3 - checkpoint;
+  } else {
+    off3 = checkpoint - res3;
+  }
+  if (times == 0) {
+    if (off1 < off2) {
+      return res1;
+    } else {
+      return res2;
+    }
+  } else {
+    if (off1 < off2 && off1 < off3) {
+      return res1;
+    } else if (off2 < off1 && off2 < off3) {
+      return res2;
+    } else {
+      return res3;
+    }
+  }
+}
+
+template <typename Unwrap>
+double time_unwrap(const vector<Wrap32> &values, Wrap32 zero_point,
+                   uint64_t checkpoint, vector<uint64_t> &out, size_t rounds,
+                   Unwrap &&unwrap) {
+  const auto start_time = steady_clock::now();
+  for (size_t round = 0; round < rounds; ++round) {
+    unwrap(values, zero_point, checkpoint + round, out);
+  }
+  const auto stop_time = steady_clock::now();
+  return static_cast<double>(
+             duration_cast<nanoseconds>(stop_time - start_time).count()) /
+         static_cast<double>(rounds * values.size());
+}
+
+}  // namespace
+
+void speed_test(const size_t burst, const size_t rounds,
+                const size_t random_seed) {
+  default_random_engine rd{random_seed};
+  const Wrap32 zero_point{uniform_int_distribution<uint32_t>{}(rd)};
+  const uint64_t checkpoint =
+      uniform_int_distribution<uint64_t>{0, uint64_t{1} << 40}(rd);
+
+  // ACKs scattered around the checkpoint, as in a burst from one peer
+  vector<Wrap32> values;
+  uniform_int_distribution<int64_t> spread{-(1L << 20), 1L << 20};
+  for (size_t i = 0; i < burst; ++i) {
+    values.push_back(Wrap32::wrap(checkpoint + spread(rd), zero_point));
+  }
+
+  vector<uint64_t> legacy(burst), scalar(burst), batch(burst);
+  const double legacy_ns = time_unwrap(
+      values, zero_point, checkpoint, legacy, rounds,
+      [](const auto &in, Wrap32 zero, uint64_t check, auto &out) {
+        for (size_t i = 0; i < in.size(); ++i) {
+          out[i] = legacy_unwrap(in[i], zero, check);
+        }
+      });
+  const double scalar_ns = time_unwrap(
+      values, zero_point, checkpoint, scalar, rounds,
+      [](const auto &in, Wrap32 zero, uint64_t check, auto &out) {
+        for (size_t i = 0; i < in.size(); ++i) {
+          out[i] = in[i].unwrap(zero, check);
+        }
+      });
+  const double batch_ns = time_unwrap(
+      values, zero_point, checkpoint, batch, rounds,
+      [](const auto &in, Wrap32 zero, uint64_t check, auto &out) {
+        Wrap32::unwrap_batch(in, zero, check, out);
+      });
+
+  if (legacy != scalar or scalar != batch) {
+    throw runtime_error("Mismatch between unwrap implementations");
+  }
+
+  fstream debug_output;
+  debug_output.open("/dev/tty");
+
+  cout << "Wrap32::unwrap over bursts of " << burst << ": legacy " << fixed
+       << setprecision(2) << legacy_ns << " ns, branchless " << scalar_ns
+       << " ns, unwrap_batch " << batch_ns << " ns per value.\n";
+
+  debug_output << "             unwrap (burst " << burst << "): legacy "
+               << fixed << setprecision(2) << legacy_ns << " ns, branchless "
+               << scalar_ns << " ns, batch " << batch_ns << " ns\n";
+
+  if (batch_ns > legacy_ns) {
+    throw runtime_error("unwrap_batch was slower than the legacy unwrap.");
+  }
+}
+
+void program_body() {
+  speed_test(64, 200000, 1370);
+  speed_test(4096, 4000, 1371);
+}
+
+int main() {
+  try {
+    program_body();
+  } catch (const exception &e) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
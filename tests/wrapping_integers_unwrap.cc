@@ -3,6 +3,7 @@
 #include <iostream>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 #include "test_should_be.hh"
 #include "wrapping_integers.hh"
@@ -42,6 +43,24 @@ int main() {
     // Nearly big unwrap with non-zero ISN
     test_should_be(Wrap32(UINT32_MAX).unwrap(Wrap32(1UL << 31), 0),
                    static_cast<uint64_t>(UINT32_MAX) >> 1);
+
+    // Unwrap at compile time
+    static_assert(Wrap32(1).unwrap(Wrap32(0), UINT32_MAX) == (1UL << 32) + 1);
+
+    // Batch unwrap, near the start of the stream and far from it
+    for (const uint64_t checkpoint :
+         {0UL, 1000UL, 1UL << 31, 3 * (1UL << 32) + 17}) {
+      vector<Wrap32> values;
+      for (uint32_t i = 0; i < 37; ++i) {
+        values.push_back(Wrap32{i * 0x0FFF'FFFFU});
+      }
+      vector<uint64_t> out(values.size());
+      Wrap32::unwrap_batch(values, Wrap32(UINT32_MAX - 5), checkpoint, out);
+      for (size_t i = 0; i < values.size(); ++i) {
+        test_should_be(out[i],
+                       values[i].unwrap(Wrap32(UINT32_MAX - 5), checkpoint));
+      }
+    }
   } catch (const exception& e) {
     cerr << e.what() << endl;
     return 1;
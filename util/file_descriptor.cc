@@ -153,6 +153,38 @@ void FileDescriptor::read(vector<unique_ptr<string>> &buffers) {
   }
 }
 
+size_t FileDescriptor::read(const vector<span<char>> &buffers) {
+  vector<iovec> iovecs;
+  iovecs.reserve(buffers.size());
+  size_t total_size = 0;
+  for (const auto x : buffers) {
+    iovecs.push_back({x.data(), x.size()});
+    total_size += x.size();
+  }
+
+  const ssize_t bytes_read =
+      ::readv(fd_num(), iovecs.data(), static_cast<int>(iovecs.size()));
+  if (bytes_read < 0) {
+    if (internal_fd_->non_blocking_ and
+        (errno == EAGAIN or errno == EINPROGRESS)) {
+      return 0;
+    }
+    throw unix_error{"readv"};
+  }
+
+  register_read();
+
+  if (bytes_read == 0 and total_size != 0) {
+    internal_fd_->eof_ = true;
+  }
+
+  if (bytes_read > static_cast<ssize_t>(total_size)) {
+    throw runtime_error("readv() read more than requested");
+  }
+
+  return bytes_read;
+}
+
 size_t FileDescriptor::write(string_view buffer) {
   return write(vector<string_view>{buffer});
 }
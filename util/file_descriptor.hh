@@ -3,6 +3,8 @@
 #include <cstddef>
 #include <limits>
 #include <memory>
+#include <span>
+#include <string_view>
 #include <vector>
 
 // A reference-counted handle to a file descriptor
@@ -70,6 +72,9 @@ class FileDescriptor {
   // Read into `buffer`
   void read(std::string &buffer);
   void read(std::vector<std::unique_ptr<std::string>> &buffers);
+  // Read straight into caller-owned memory (e.g. Writer::writable_spans())
+  // returns number of bytes read
+  size_t read(const std::vector<std::span<char>> &buffers);
 
   // Attempt to write a buffer
   // returns number of bytes written
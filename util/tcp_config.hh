@@ -16,6 +16,20 @@ class TCPConfig {
       1000;  //!< Default re-transmit timeout is 1 second
   static constexpr unsigned MAX_RETX_ATTEMPTS =
       8;  //!< Maximum re-transmit attempts before giving up
+  static constexpr size_t MAX_SACK_BLOCKS =
+      4;  //!< Most SACK blocks that fit in the TCP options space
+  static constexpr uint64_t ACK_DELAY_DFLT =
+      40;  //!< Default delayed-ACK timeout, in milliseconds
+  static constexpr uint8_t MAX_WINDOW_SCALE =
+      14;  //!< Largest window scale allowed by RFC 7323
+  static constexpr uint64_t INITIAL_CWND_SEGMENTS =
+      10;  //!< Initial congestion window, in segments (RFC 6928)
+  static constexpr uint64_t DUP_ACK_THRESHOLD =
+      3;  //!< Duplicate ACKs that trigger fast retransmit (RFC 5681)
+  static constexpr uint64_t MIN_RTO_DFLT =
+      200;  //!< Default lower bound on an adaptive RTO, in milliseconds
+  static constexpr uint64_t MAX_RTO_DFLT =
+      60000;  //!< Default upper bound on an adaptive RTO (RFC 6298 2.5)
 
   uint16_t rt_timeout = TIMEOUT_DFLT;  //!< Initial value of the retransmission
                                        //!< timeout, in milliseconds
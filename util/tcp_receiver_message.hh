@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cstdint>
 #include <optional>
+#include <vector>
 
 #include "wrapping_integers.hh"
 
@@ -8,18 +10,42 @@
  * The TCPReceiverMessage structure contains the information sent from a TCP
  * receiver to its sender.
  *
- * It contains two fields:
+ * It contains five fields:
  *
  * 1) The acknowledgment number (ackno): the *next* sequence number needed by
  * the TCP Receiver. This is an optional field that is empty if the TCPReceiver
  * hasn't yet received the Initial Sequence Number.
  *
  * 2) The window size. This is the number of sequence numbers that the TCP
- * receiver is interested to receive, starting from the ackno if present. The
- * maximum value is 65,535 (UINT16_MAX from the <cstdint> header).
+ * receiver is interested to receive, starting from the ackno if present, in
+ * units of 2^window_scale. The maximum value is 65,535 (UINT16_MAX from the
+ * <cstdint> header).
+ *
+ * 3) The SACK blocks (RFC 2018): runs of sequence numbers past the ackno that
+ * the receiver already holds, each as [left_edge, right_edge). The first block
+ * contains the most recently received segment, and the rest follow from most
+ * to least recent.
+ *
+ * 4) The window scale (RFC 7323): how far window_size is shifted left. It is
+ * zero unless the SYN carried a window scale option, and at most 14.
+ *
+ * 5) The timestamp echo reply, TSecr (RFC 7323): the TSval of the segment
+ * that most recently advanced the ackno, or of the earliest one held back by
+ * a delayed ACK. It is empty unless the SYN carried a timestamp.
  */
 
+struct SACKBlock {
+  Wrap32 left_edge{0};
+  Wrap32 right_edge{0};
+};
+
 struct TCPReceiverMessage {
   std::optional<Wrap32> ackno{};
   uint16_t window_size{};
+  std::vector<SACKBlock> sack_blocks{};
+  uint8_t window_scale{};
+  std::optional<uint32_t> tsecr{};
+
+  // The window in sequence numbers, with the scale applied
+  uint64_t window() const { return uint64_t{window_size} << window_scale; }
 };
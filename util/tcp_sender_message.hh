@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+#include <optional>
 #include <string>
 
 #include "buffer.hh"
@@ -9,7 +11,7 @@
  * The TCPSenderMessage structure contains the information sent from a TCP
  * sender to its receiver.
  *
- * It contains four fields:
+ * It contains seven fields:
  *
  * 1) The sequence number (seqno) of the beginning of the segment. If the SYN
  * flag is set, this is the sequence number of the SYN flag. Otherwise, it's the
@@ -23,6 +25,20 @@
  *
  * 4) The FIN flag. If set, it means the payload represents the ending of the
  * byte stream.
+ *
+ * 5) The window scale option (RFC 7323), only alongside SYN. If present, the
+ * sender can use windows that the receiver scales (see TCPReceiverMessage).
+ * Its value is the scale the sending side applies to the windows it
+ * advertises itself.
+ *
+ * 6) The timestamp value, TSval (RFC 7323): the sender's clock, in
+ * milliseconds, when this segment was (re)transmitted. The receiver echoes it
+ * back as TSecr (see TCPReceiverMessage). Timestamps are in use on a
+ * connection only if the SYN carried one.
+ *
+ * 7) The SACK-permitted option (RFC 2018), only alongside SYN. If set, the
+ * sender can make use of SACK blocks (see TCPReceiverMessage), and the
+ * receiver reports them; otherwise it sends none.
  */
 
 struct TCPSenderMessage {
@@ -30,6 +46,9 @@ struct TCPSenderMessage {
   bool SYN{false};
   Buffer payload{};
   bool FIN{false};
+  std::optional<uint8_t> window_scale{};
+  std::optional<uint32_t> tsval{};
+  bool sack_permitted{false};
 
   // How many sequence numbers does this segment use?
   size_t sequence_length() const { return SYN + payload.size() + FIN; }